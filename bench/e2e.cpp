@@ -0,0 +1,475 @@
+// End-to-end throughput of the crawler path without the internet: a corpus
+// of images is served from a local HTTP server with injected latency,
+// bandwidth limits and errors, and Crawler::scanUrls() downloads, decodes,
+// embeds and matches every one of them.
+//
+//   ./build/facereco-e2e-bench --images 500 --latency-ms 30 --error-rate 0.02 --json -
+#include "crawler.hpp"
+#include "face_embedder.hpp"
+#include "metrics.hpp"
+#include <opencv2/imgcodecs.hpp>
+#include <opencv2/imgproc.hpp>
+#include <nlohmann/json.hpp>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <poll.h>
+#include <unistd.h>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <random>
+#include <sstream>
+#include <streambuf>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace fs = std::filesystem;
+using json = nlohmann::json;
+
+namespace {
+
+struct CorpusImage {
+    std::string name;         // served as /images/<name>
+    std::string contentType;
+    std::string data;
+    bool face = false;        // expected to match the reference
+};
+
+// Injected on every response
+struct Faults {
+    int latencyMs = 0;            // before the response starts
+    int jitterMs = 0;             // plus up to this much, uniformly
+    size_t bytesPerSecond = 0;    // 0: unlimited
+    double errorRate = 0.0;       // half of these are 500s, half dropped connections
+};
+
+std::string contentTypeFor(const std::string& extension) {
+    if (extension == ".png") return "image/png";
+    if (extension == ".bmp") return "image/bmp";
+    if (extension == ".webp") return "image/webp";
+    return "image/jpeg";
+}
+
+std::string encode(const cv::Mat& image, const std::string& extension) {
+    std::vector<uchar> bytes;
+    if (extension == ".jpg")
+        cv::imencode(extension, image, bytes, {cv::IMWRITE_JPEG_QUALITY, 90});
+    else
+        cv::imencode(extension, image, bytes);
+    return std::string(bytes.begin(), bytes.end());
+}
+
+// Gradients, blobs and noise: photo-like for the codecs, but no face
+cv::Mat clutter(int width, int height, std::mt19937& rng) {
+    cv::Mat image(height, width, CV_8UC3);
+    for (int y = 0; y < height; ++y) {
+        cv::Vec3b* row = image.ptr<cv::Vec3b>(y);
+        for (int x = 0; x < width; ++x)
+            row[x] = cv::Vec3b(x * 255 / width, y * 255 / height, (x + y) * 127 / (width + height));
+    }
+    std::uniform_int_distribution<int> coordinate(0, std::max(width, height));
+    std::uniform_int_distribution<int> channel(0, 255);
+    for (int i = 0; i < 12; ++i) {
+        cv::circle(image, cv::Point(coordinate(rng), coordinate(rng)), coordinate(rng) / 6 + 4,
+                   cv::Scalar(channel(rng), channel(rng), channel(rng)), cv::FILLED);
+    }
+    cv::Mat noise(height, width, CV_8UC3);
+    cv::randn(noise, cv::Scalar::all(0), cv::Scalar::all(10));
+    image += noise;
+    return image;
+}
+
+// `count` images cycling through sizes and formats. Every 1/faceRatio-th
+// one is the reference itself, rescaled and re-encoded, so it matches.
+std::vector<CorpusImage> syntheticCorpus(const cv::Mat& reference, int count, double faceRatio, unsigned seed) {
+    static const cv::Size sizes[] = {{160, 160}, {320, 240}, {640, 480}, {1280, 960}, {1920, 1080}};
+    static const char* extensions[] = {".jpg", ".png", ".jpg", ".bmp"};
+    std::mt19937 rng(seed);
+    std::vector<CorpusImage> corpus;
+    int faceEvery = faceRatio > 0.0 ? std::max(1, static_cast<int>(1.0 / faceRatio)) : 0;
+    for (int i = 0; i < count; ++i) {
+        const cv::Size& size = sizes[i % 5];
+        std::string extension = extensions[(i / 5) % 4];
+        CorpusImage image;
+        image.face = faceEvery && i % faceEvery == faceEvery / 2;
+        cv::Mat pixels;
+        if (image.face) {
+            cv::resize(reference, pixels, size, 0, 0, cv::INTER_AREA);
+            pixels.convertTo(pixels, -1, 1.0, (i % 3 - 1) * 12.0);  // small brightness shifts
+        } else {
+            pixels = clutter(size.width, size.height, rng);
+        }
+        image.name = std::to_string(i) + extension;
+        image.contentType = contentTypeFor(extension);
+        image.data = encode(pixels, extension);
+        corpus.push_back(std::move(image));
+    }
+    return corpus;
+}
+
+// Every file under `dir` that OpenCV can decode, served as stored. Files
+// whose name contains "face" count as expected matches.
+std::vector<CorpusImage> loadCorpus(const std::string& dir) {
+    std::vector<CorpusImage> corpus;
+    for (const auto& entry : fs::recursive_directory_iterator(dir)) {
+        if (!entry.is_regular_file())
+            continue;
+        std::ifstream in(entry.path(), std::ios::binary);
+        std::string data((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+        if (cv::imdecode(std::vector<uchar>(data.begin(), data.end()), cv::IMREAD_COLOR).empty())
+            continue;
+        CorpusImage image;
+        image.name = std::to_string(corpus.size()) + entry.path().extension().string();
+        image.contentType = contentTypeFor(entry.path().extension().string());
+        image.data = std::move(data);
+        image.face = entry.path().filename().string().find("face") != std::string::npos;
+        corpus.push_back(std::move(image));
+    }
+    return corpus;
+}
+
+void sendAll(int fd, const char* data, size_t size) {
+    size_t sent = 0;
+    while (sent < size) {
+        ssize_t n = ::send(fd, data + sent, size - sent, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            return;
+        sent += static_cast<size_t>(n);
+    }
+}
+
+// HTTP/1.1 on 127.0.0.1 with keep-alive, one thread per connection, so the
+// crawler's reused connection behaves as it would against a real host.
+class LocalImageServer {
+public:
+    LocalImageServer(const std::vector<CorpusImage>& corpus, Faults faults, unsigned seed)
+        : faults(faults), rng(seed) {
+        for (const CorpusImage& image : corpus)
+            images["/images/" + image.name] = &image;
+    }
+
+    ~LocalImageServer() {
+        stopping = true;
+        if (acceptor.joinable())
+            acceptor.join();
+        for (std::thread& connection : connections)
+            connection.join();
+        if (listenFd >= 0)
+            ::close(listenFd);
+    }
+
+    LocalImageServer(const LocalImageServer&) = delete;
+    LocalImageServer& operator=(const LocalImageServer&) = delete;
+
+    // Binds an ephemeral port; see port()
+    bool start() {
+        listenFd = ::socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (listenFd < 0)
+            return false;
+        sockaddr_in address{};
+        address.sin_family = AF_INET;
+        address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        socklen_t length = sizeof(address);
+        if (::bind(listenFd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0 ||
+            ::listen(listenFd, 64) < 0 ||
+            ::getsockname(listenFd, reinterpret_cast<sockaddr*>(&address), &length) < 0) {
+            std::cerr << "Cannot start the image server: " << std::strerror(errno) << "\n";
+            return false;
+        }
+        boundPort = ntohs(address.sin_port);
+        acceptor = std::thread([this] { serve(); });
+        return true;
+    }
+
+    int port() const { return boundPort; }
+
+private:
+    enum class Outcome { Serve, Fail, Drop };
+
+    void serve() {
+        while (!stopping) {
+            pollfd pfd{listenFd, POLLIN, 0};
+            if (::poll(&pfd, 1, 200) <= 0)
+                continue;
+            int fd = ::accept4(listenFd, nullptr, nullptr, SOCK_CLOEXEC);
+            if (fd < 0)
+                continue;
+            // Headers and throttled slices go out as written, not after a delayed ACK
+            int noDelay = 1;
+            ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &noDelay, sizeof(noDelay));
+            connections.emplace_back([this, fd] { handle(fd); });
+        }
+    }
+
+    // Latency and outcome of the next response
+    std::pair<int, Outcome> draw() {
+        std::lock_guard<std::mutex> lock(rngMutex);
+        std::uniform_real_distribution<double> unit(0.0, 1.0);
+        int delay = faults.latencyMs + (faults.jitterMs > 0 ? static_cast<int>(unit(rng) * faults.jitterMs) : 0);
+        double roll = unit(rng);
+        Outcome outcome = roll >= faults.errorRate ? Outcome::Serve
+                          : roll < faults.errorRate / 2 ? Outcome::Fail : Outcome::Drop;
+        return {delay, outcome};
+    }
+
+    void handle(int fd) {
+        std::string pending;
+        char chunk[4096];
+        while (!stopping) {
+            size_t end = pending.find("\r\n\r\n");
+            if (end == std::string::npos) {
+                pollfd pfd{fd, POLLIN, 0};
+                if (::poll(&pfd, 1, 200) <= 0)
+                    continue;
+                ssize_t n = ::recv(fd, chunk, sizeof(chunk), 0);
+                if (n < 0 && errno == EINTR)
+                    continue;
+                if (n <= 0)
+                    break;
+                pending.append(chunk, static_cast<size_t>(n));
+                continue;
+            }
+
+            std::istringstream line(pending.substr(0, pending.find("\r\n")));
+            pending.erase(0, end + 4);
+            std::string method, path;
+            line >> method >> path;
+
+            auto [delay, outcome] = draw();
+            std::this_thread::sleep_for(std::chrono::milliseconds(delay));
+            if (outcome == Outcome::Drop)
+                break;
+
+            auto it = images.find(path);
+            const CorpusImage* image = method == "GET" && it != images.end() ? it->second : nullptr;
+            std::string status = "200 OK", type = "text/plain", body;
+            if (outcome == Outcome::Fail) {
+                status = "500 Internal Server Error";
+                body = "injected error";
+            } else if (!image) {
+                status = "404 Not Found";
+            } else {
+                type = image->contentType;
+            }
+            const std::string& payload = image && outcome == Outcome::Serve ? image->data : body;
+
+            std::ostringstream header;
+            header << "HTTP/1.1 " << status << "\r\n"
+                   << "Content-Type: " << type << "\r\n"
+                   << "Content-Length: " << payload.size() << "\r\n\r\n";
+            std::string head = header.str();
+            sendAll(fd, head.data(), head.size());
+            sendBody(fd, payload);
+        }
+        ::close(fd);
+    }
+
+    // At most bytesPerSecond, in 10 ms slices
+    void sendBody(int fd, const std::string& payload) {
+        if (!faults.bytesPerSecond) {
+            sendAll(fd, payload.data(), payload.size());
+            return;
+        }
+        size_t slice = std::max<size_t>(1, faults.bytesPerSecond / 100);
+        for (size_t offset = 0; offset < payload.size() && !stopping; offset += slice) {
+            sendAll(fd, payload.data() + offset, std::min(slice, payload.size() - offset));
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+    }
+
+    std::map<std::string, const CorpusImage*> images;
+    Faults faults;
+    std::mutex rngMutex;
+    std::mt19937 rng;
+    int listenFd = -1;
+    int boundPort = 0;
+    std::atomic<bool> stopping{false};
+    std::thread acceptor;
+    std::vector<std::thread> connections;   // only touched by the acceptor until it is joined
+};
+
+// Swallows the crawler's per-image progress lines
+class NullBuffer : public std::streambuf {
+protected:
+    int overflow(int c) override { return c; }
+};
+
+double cpuSeconds(const rusage& usage) {
+    return usage.ru_utime.tv_sec + usage.ru_stime.tv_sec +
+           (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1e6;
+}
+
+void printUsage() {
+    std::cerr <<
+        "Usage: facereco-e2e-bench [options]\n"
+        "\n"
+        "  --reference <image>     Face to search for (default: a synthetic image)\n"
+        "  --corpus <dir>          Serve these images instead of a synthetic corpus;\n"
+        "                          files named *face* are expected to match\n"
+        "  --images <n>            Synthetic corpus size (default 200)\n"
+        "  --face-ratio <f>        Fraction of synthetic images that match (default 0.1)\n"
+        "  --latency-ms <n>        Delay before each response (default 0)\n"
+        "  --jitter-ms <n>         Plus up to this much at random (default 0)\n"
+        "  --bandwidth-kbps <n>    Per-connection download limit (default unlimited)\n"
+        "  --error-rate <f>        Fraction of failed responses (default 0)\n"
+        "  --seed <n>              For the corpus and injected faults (default 1)\n"
+        "  --json <file|->         Also write the results as JSON\n"
+        "  --verbose               Keep the crawler's progress output\n";
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    std::map<std::string, std::string> flags;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg.rfind("--", 0) != 0) {
+            printUsage();
+            return 2;
+        }
+        std::string value;
+        if (i + 1 < argc && std::string(argv[i + 1]).rfind("--", 0) != 0)
+            value = argv[++i];
+        flags[arg.substr(2)] = value;
+    }
+    auto get = [&](const std::string& name, const std::string& fallback) {
+        auto it = flags.find(name);
+        return it == flags.end() ? fallback : it->second;
+    };
+    if (flags.count("help")) {
+        printUsage();
+        return 0;
+    }
+
+    const unsigned seed = static_cast<unsigned>(std::stoul(get("seed", "1")));
+    std::mt19937 rng(seed);
+    cv::Mat reference = flags.count("reference") ? cv::imread(get("reference", "")) : clutter(320, 320, rng);
+    if (reference.empty()) {
+        std::cerr << "Cannot read the reference image\n";
+        return 1;
+    }
+
+    std::vector<CorpusImage> corpus = flags.count("corpus")
+        ? loadCorpus(get("corpus", ""))
+        : syntheticCorpus(reference, std::stoi(get("images", "200")), std::stod(get("face-ratio", "0.1")), seed);
+    if (corpus.empty()) {
+        std::cerr << "The corpus is empty\n";
+        return 1;
+    }
+
+    // Model load and the reference embedding are startup costs, not throughput
+    if (!preloadFaceEmbedder()) {
+        std::cerr << "Cannot load the model; run from the repository root\n";
+        return 1;
+    }
+    std::vector<float> referenceEmbedding = extractEmbeddingFromImage(reference);
+    if (referenceEmbedding.empty())
+        return 1;
+
+    Faults faults;
+    faults.latencyMs = std::stoi(get("latency-ms", "0"));
+    faults.jitterMs = std::stoi(get("jitter-ms", "0"));
+    faults.bytesPerSecond = static_cast<size_t>(std::stoul(get("bandwidth-kbps", "0"))) * 1000 / 8;
+    faults.errorRate = std::stod(get("error-rate", "0"));
+    LocalImageServer server(corpus, faults, seed);
+    if (!server.start())
+        return 1;
+
+    std::vector<std::string> urls;
+    size_t expected = 0;
+    size_t corpusBytes = 0;
+    for (const CorpusImage& image : corpus) {
+        urls.push_back("http://127.0.0.1:" + std::to_string(server.port()) + "/images/" + image.name);
+        expected += image.face;
+        corpusBytes += image.data.size();
+    }
+
+    using Clock = std::chrono::steady_clock;
+    Crawler crawler("");
+    crawler.setReferenceEmbedding(referenceEmbedding);
+    Clock::time_point start;
+    double firstMatchMs = -1.0;
+    crawler.setMatchCallback([&](const MatchResult&) {
+        if (firstMatchMs < 0)
+            firstMatchMs = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    });
+
+    NullBuffer discard;
+    std::streambuf* stdoutBuffer = flags.count("verbose") ? nullptr : std::cout.rdbuf(&discard);
+    rusage before{}, after{};
+    ::getrusage(RUSAGE_SELF, &before);
+    start = Clock::now();
+    crawler.scanUrls(urls, "bench");
+    double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    ::getrusage(RUSAGE_SELF, &after);
+    if (stdoutBuffer)
+        std::cout.rdbuf(stdoutBuffer);
+
+    MetricsSnapshot metrics = MetricsRegistry::instance().snapshot();
+    const HistogramSnapshot& image = metrics.histograms["image_ms"];
+    json stages = json::object();
+    for (const char* stage : {"download_ms", "decode_ms", "preprocess_ms", "inference_ms", "match_ms"}) {
+        const HistogramSnapshot& histogram = metrics.histograms[stage];
+        stages[stage] = {{"count", histogram.count}, {"p50_ms", histogram.quantile(0.5)},
+                         {"p99_ms", histogram.quantile(0.99)}};
+    }
+    const double cpu = cpuSeconds(after) - cpuSeconds(before);
+    const unsigned cores = std::max(1u, std::thread::hardware_concurrency());
+
+    json results = {
+        {"images", corpus.size()},
+        {"corpus_bytes", corpusBytes},
+        {"seconds", seconds},
+        {"images_per_second", corpus.size() / seconds},
+        {"matches", crawler.getMatchedImages().size()},
+        {"expected_matches", expected},
+        {"time_to_first_match_ms", firstMatchMs},
+        {"image_p50_ms", image.quantile(0.5)},
+        {"image_p99_ms", image.quantile(0.99)},
+        {"http_errors", metrics.counters["http_errors"]},
+        {"cpu_percent", 100.0 * cpu / seconds},
+        {"cpu_percent_of_machine", 100.0 * cpu / seconds / cores},
+        {"peak_rss_bytes", static_cast<uint64_t>(after.ru_maxrss) * 1024},
+        {"stages", stages},
+        {"faults", {{"latency_ms", faults.latencyMs}, {"jitter_ms", faults.jitterMs},
+                    {"bytes_per_second", faults.bytesPerSecond}, {"error_rate", faults.errorRate}}},
+    };
+
+    std::cout << corpus.size() << " images (" << corpusBytes / 1024 << " KiB) in " << seconds << " s: "
+              << results["images_per_second"].get<double>() << " images/s\n"
+              << "matches: " << crawler.getMatchedImages().size() << " of " << expected << " expected, first after "
+              << firstMatchMs << " ms\n"
+              << "per image: p50 " << image.quantile(0.5) << " ms, p99 " << image.quantile(0.99) << " ms\n";
+    for (const auto& [stage, values] : stages.items())
+        std::cout << "  " << stage << ": p50 " << values["p50_ms"].get<double>() << " ms, p99 "
+                  << values["p99_ms"].get<double>() << " ms\n";
+    std::cout << "CPU: " << results["cpu_percent"].get<double>() << "% of one core, peak RSS "
+              << results["peak_rss_bytes"].get<uint64_t>() / (1024 * 1024) << " MiB\n";
+
+    if (flags.count("json")) {
+        std::string path = get("json", "-");
+        if (path == "-" || path.empty()) {
+            std::cout << results.dump(2) << "\n";
+        } else {
+            std::ofstream out(path);
+            out << results.dump(2) << "\n";
+            if (!out) {
+                std::cerr << "Cannot write " << path << "\n";
+                return 1;
+            }
+        }
+    }
+    return 0;
+}
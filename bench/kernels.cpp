@@ -0,0 +1,196 @@
+// Microbenchmarks for the per-image kernels. Build with
+// -DFACERECO_BUILD_BENCHMARKS=ON and run from the repository root so the
+// model is found (or set FACERECO_BENCH_MODEL):
+//
+//   ./build/facereco-bench --benchmark_filter=Tensor
+#include "crawler.hpp"
+#include "image_view.hpp"
+#include "onnx_face_compare.hpp"
+#include <benchmark/benchmark.h>
+#include <opencv2/imgcodecs.hpp>
+#include <opencv2/imgproc.hpp>
+#include <cstdlib>
+#include <exception>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+// Smooth gradients plus noise, so codecs see something photo-like
+cv::Mat syntheticImage(int width, int height) {
+    cv::Mat image(height, width, CV_8UC3);
+    for (int y = 0; y < height; ++y) {
+        cv::Vec3b* row = image.ptr<cv::Vec3b>(y);
+        for (int x = 0; x < width; ++x)
+            row[x] = cv::Vec3b(x * 255 / width, y * 255 / height, (x + y) * 127 / (width + height));
+    }
+    cv::Mat noise(height, width, CV_8UC3);
+    cv::randn(noise, cv::Scalar::all(0), cv::Scalar::all(12));
+    image += noise;
+    return image;
+}
+
+ImageView viewOf(const cv::Mat& image) {
+    ImageView view;
+    view.data = image.data;
+    view.width = image.cols;
+    view.height = image.rows;
+    view.stride = image.step;
+    view.layout = layouts::Bgr;
+    return view;
+}
+
+std::vector<float> randomEmbedding(size_t size, unsigned seed) {
+    std::mt19937 rng(seed);
+    std::normal_distribution<float> normal;
+    std::vector<float> embedding(size);
+    for (float& v : embedding)
+        v = normal(rng);
+    return embedding;
+}
+
+// A results page with `count` candidates among unrelated markup
+std::string resultsPage(int count) {
+    std::string html = "<html><body>";
+    for (int i = 0; i < count; ++i) {
+        html += "<div class=\"serp-item\" data-bem='{\"serp-item\":{\"pos\":" + std::to_string(i) + "}}'>";
+        html += "<a href=\"/images/search?img_url=https%3A%2F%2Fexample.com%2Fphotos%2F" + std::to_string(i) +
+                ".jpg&amp;pos=" + std::to_string(i) + "&amp;rpt=simage\">";
+        html += std::string(400, 'x') + "</a></div>";
+    }
+    return html + "</body></html>";
+}
+
+// Hand-rolled alternative to findImageUrls(): plain find() instead of std::regex
+std::vector<std::string> findImageUrlsScan(const std::string& html) {
+    static const std::string key = "img_url=";
+    std::vector<std::string> urls;
+    for (size_t at = html.find(key); at != std::string::npos; at = html.find(key, at)) {
+        at += key.size();
+        size_t end = html.find('&', at);
+        std::string encoded = html.substr(at, end == std::string::npos ? std::string::npos : end - at);
+        std::string decoded;
+        decoded.reserve(encoded.size());
+        for (size_t i = 0; i < encoded.size(); ++i) {
+            if (encoded[i] == '%' && i + 2 < encoded.size()) {
+                decoded += static_cast<char>(std::stoi(encoded.substr(i + 1, 2), nullptr, 16));
+                i += 2;
+            } else {
+                decoded += encoded[i];
+            }
+        }
+        urls.push_back(std::move(decoded));
+    }
+    return urls;
+}
+
+FaceEmbeddingExtractor* extractor(benchmark::State& state) {
+    static std::unique_ptr<FaceEmbeddingExtractor> loaded;
+    static bool tried = false;
+    if (!tried) {
+        tried = true;
+        const char* path = std::getenv("FACERECO_BENCH_MODEL");
+        try {
+            loaded = std::make_unique<FaceEmbeddingExtractor>(path ? path : kDefaultModelPath);
+        } catch (const std::exception&) {
+        }
+    }
+    if (!loaded)
+        state.SkipWithError("model not found; run from the repository root or set FACERECO_BENCH_MODEL");
+    return loaded.get();
+}
+
+// Square input images of state.range(0) pixels
+void BM_PreprocessFace(benchmark::State& state) {
+    cv::Mat image = syntheticImage(static_cast<int>(state.range(0)), static_cast<int>(state.range(0)));
+    for (auto _ : state)
+        benchmark::DoNotOptimize(preprocessFace(image));
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_PreprocessFace)->Arg(112)->Arg(160)->Arg(640)->Arg(1920);
+
+// The fused resize/convert/pack path used by FaceEmbeddingExtractor;
+// range(1) selects NCHW (the CHW models) over NHWC
+void BM_WriteTensor(benchmark::State& state) {
+    cv::Mat image = syntheticImage(static_cast<int>(state.range(0)), static_cast<int>(state.range(0)));
+    ImageView view = viewOf(image);
+    const bool channelsFirst = state.range(1) != 0;
+    std::vector<float> tensor(160 * 160 * 3);
+    for (auto _ : state) {
+        writeTensor(view, 160, 160, channelsFirst, tensor.data());
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_WriteTensor)->ArgsProduct({{112, 160, 640, 1920}, {0, 1}});
+
+void BM_CosineSimilarity(benchmark::State& state) {
+    std::vector<float> a = randomEmbedding(static_cast<size_t>(state.range(0)), 1);
+    std::vector<float> b = randomEmbedding(static_cast<size_t>(state.range(0)), 2);
+    for (auto _ : state)
+        benchmark::DoNotOptimize(cosineSimilarity(a, b));
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_CosineSimilarity)->Arg(128)->Arg(512)->Arg(2048);
+
+// range(0) is the width of a 4:3 image, range(1) selects PNG over JPEG
+void BM_Decode(benchmark::State& state) {
+    const int width = static_cast<int>(state.range(0));
+    std::vector<uchar> encoded;
+    cv::imencode(state.range(1) ? ".png" : ".jpg", syntheticImage(width, width * 3 / 4), encoded);
+    for (auto _ : state)
+        benchmark::DoNotOptimize(cv::imdecode(encoded, cv::IMREAD_COLOR));
+    state.SetItemsProcessed(state.iterations());
+    state.SetBytesProcessed(state.iterations() * static_cast<int64_t>(encoded.size()));
+}
+BENCHMARK(BM_Decode)->ArgsProduct({{160, 640, 1280, 1920}, {0, 1}})->Unit(benchmark::kMicrosecond);
+
+void BM_ParseResultsRegex(benchmark::State& state) {
+    std::string html = resultsPage(static_cast<int>(state.range(0)));
+    for (auto _ : state)
+        benchmark::DoNotOptimize(findImageUrls(html));
+    state.SetBytesProcessed(state.iterations() * static_cast<int64_t>(html.size()));
+}
+BENCHMARK(BM_ParseResultsRegex)->Arg(10)->Arg(100)->Unit(benchmark::kMicrosecond);
+
+void BM_ParseResultsScan(benchmark::State& state) {
+    std::string html = resultsPage(static_cast<int>(state.range(0)));
+    for (auto _ : state)
+        benchmark::DoNotOptimize(findImageUrlsScan(html));
+    state.SetBytesProcessed(state.iterations() * static_cast<int64_t>(html.size()));
+}
+BENCHMARK(BM_ParseResultsScan)->Arg(10)->Arg(100)->Unit(benchmark::kMicrosecond);
+
+// One Run() per face
+void BM_InferenceSingle(benchmark::State& state) {
+    FaceEmbeddingExtractor* model = extractor(state);
+    if (!model)
+        return;
+    std::vector<cv::Mat> faces(static_cast<size_t>(state.range(0)), syntheticImage(160, 160));
+    for (auto _ : state) {
+        for (const cv::Mat& face : faces)
+            benchmark::DoNotOptimize(model->getEmbedding(face));
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_InferenceSingle)->RangeMultiplier(2)->Range(1, 64)->Unit(benchmark::kMillisecond);
+
+// One Run() per batch where the model has a dynamic batch dimension
+void BM_InferenceBatched(benchmark::State& state) {
+    FaceEmbeddingExtractor* model = extractor(state);
+    if (!model)
+        return;
+    if (!model->supportsBatching())
+        state.SetLabel("fixed batch size: runs one face at a time");
+    std::vector<cv::Mat> faces(static_cast<size_t>(state.range(0)), syntheticImage(160, 160));
+    for (auto _ : state)
+        benchmark::DoNotOptimize(model->getEmbeddings(faces));
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_InferenceBatched)->RangeMultiplier(2)->Range(1, 64)->Unit(benchmark::kMillisecond);
+
+}  // namespace
+
+BENCHMARK_MAIN();
@@ -0,0 +1,463 @@
+// Side-by-side comparison of embedding models: session load time, memory,
+// embeddings/s by batch size and by intra-op thread count, and verification
+// accuracy (TAR at fixed FAR) on a labeled set of face pairs. Each model is
+// measured in its own forked process, so memory figures and load times are
+// not skewed by the models measured before it. The optimized-model cache is
+// off unless --model-cache names a directory, so load times are cold starts.
+//
+//   ./build/facereco-model-bench --faces lfw/ --json models.json
+#include "metrics.hpp"
+#include "onnx_face_compare.hpp"
+#include "ort_runtime.hpp"
+#include <opencv2/imgcodecs.hpp>
+#include <nlohmann/json.hpp>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cmath>
+#include <exception>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace fs = std::filesystem;
+using json = nlohmann::json;
+using Clock = std::chrono::steady_clock;
+
+namespace {
+
+const double kFalseAcceptRates[] = {1e-1, 1e-2, 1e-3, 1e-4};
+
+// A model on the command line, with the input normalization it was trained on
+struct ModelSpec {
+    std::string path;
+    std::string preprocessing;   // "facenet" or "imagenet"
+};
+
+// "<model.onnx>[@facenet|@imagenet]"; without a suffix, ResNet exports are
+// taken to be ImageNet classifiers and everything else FaceNet-style
+ModelSpec parseModel(const std::string& arg) {
+    size_t at = arg.rfind('@');
+    if (at != std::string::npos)
+        return {arg.substr(0, at), arg.substr(at + 1)};
+    std::string name = fs::path(arg).filename().string();
+    std::transform(name.begin(), name.end(), name.begin(), [](unsigned char c) { return std::tolower(c); });
+    return {arg, name.find("resnet") != std::string::npos ? "imagenet" : "facenet"};
+}
+
+const TensorNormalization& normalizationFor(const ModelSpec& model) {
+    if (model.preprocessing == "imagenet")
+        return normalizations::ImageNet;
+    if (model.preprocessing == "facenet")
+        return normalizations::FaceNet;
+    throw std::invalid_argument("unknown preprocessing \"" + model.preprocessing + "\" for " + model.path);
+}
+
+struct PairSet {
+    std::vector<std::string> paths;
+    std::vector<cv::Mat> images;
+    std::vector<std::pair<size_t, size_t>> genuine;    // indices into images
+    std::vector<std::pair<size_t, size_t>> impostor;
+};
+
+struct Settings {
+    std::vector<int> batchSizes{1, 2, 4, 8, 16, 32, 64};
+    std::vector<int> threadCounts;
+    int scalingBatch = 16;
+    double seconds = 1.0;     // per throughput measurement
+    std::string modelCache;   // empty: ORT optimizes the model at every load
+};
+
+std::vector<int> parseList(const std::string& text) {
+    std::vector<int> values;
+    std::stringstream stream(text);
+    std::string item;
+    while (std::getline(stream, item, ','))
+        if (!item.empty())
+            values.push_back(std::stoi(item));
+    return values;
+}
+
+// One subdirectory per identity (the LFW layout). Genuine pairs are all
+// pairs within an identity, impostor pairs are drawn at random across
+// identities; both are capped to keep a run short.
+PairSet pairsFromDirectory(const std::string& dir, size_t maxPairs, unsigned seed) {
+    PairSet set;
+    std::vector<std::vector<size_t>> identities;
+    std::vector<fs::path> people;
+    for (const auto& entry : fs::directory_iterator(dir))
+        if (entry.is_directory())
+            people.push_back(entry.path());
+    std::sort(people.begin(), people.end());
+
+    for (const fs::path& person : people) {
+        std::vector<fs::path> files;
+        for (const auto& entry : fs::directory_iterator(person))
+            if (entry.is_regular_file())
+                files.push_back(entry.path());
+        std::sort(files.begin(), files.end());
+
+        std::vector<size_t> indices;
+        for (const fs::path& file : files) {
+            cv::Mat image = cv::imread(file.string());
+            if (image.empty())
+                continue;
+            indices.push_back(set.images.size());
+            set.paths.push_back(file.string());
+            set.images.push_back(std::move(image));
+        }
+        if (!indices.empty())
+            identities.push_back(std::move(indices));
+    }
+
+    for (const auto& indices : identities)
+        for (size_t i = 0; i < indices.size(); ++i)
+            for (size_t j = i + 1; j < indices.size() && set.genuine.size() < maxPairs; ++j)
+                set.genuine.emplace_back(indices[i], indices[j]);
+
+    if (identities.size() >= 2) {
+        std::mt19937 rng(seed);
+        std::uniform_int_distribution<size_t> pickIdentity(0, identities.size() - 1);
+        while (set.impostor.size() < maxPairs) {
+            size_t a = pickIdentity(rng), b = pickIdentity(rng);
+            if (a == b)
+                continue;
+            const auto& first = identities[a];
+            const auto& second = identities[b];
+            set.impostor.emplace_back(first[rng() % first.size()], second[rng() % second.size()]);
+        }
+    }
+    return set;
+}
+
+// "<image> <image> <1|0>" per line, paths relative to the list file
+PairSet pairsFromFile(const std::string& path) {
+    PairSet set;
+    std::map<std::string, size_t> loaded;
+    auto indexOf = [&](const std::string& file) -> long {
+        auto it = loaded.find(file);
+        if (it != loaded.end())
+            return static_cast<long>(it->second);
+        cv::Mat image = cv::imread((fs::path(path).parent_path() / file).string());
+        if (image.empty()) {
+            std::cerr << "Cannot read " << file << "\n";
+            return -1;
+        }
+        loaded[file] = set.images.size();
+        set.paths.push_back(file);
+        set.images.push_back(std::move(image));
+        return static_cast<long>(set.images.size() - 1);
+    };
+
+    std::ifstream in(path);
+    std::string line;
+    while (std::getline(in, line)) {
+        std::istringstream fields(line);
+        std::string a, b;
+        int same = 0;
+        if (!(fields >> a >> b >> same))
+            continue;
+        long first = indexOf(a), second = indexOf(b);
+        if (first < 0 || second < 0)
+            continue;
+        (same ? set.genuine : set.impostor).emplace_back(first, second);
+    }
+    return set;
+}
+
+// Mean embeddings/s over at least `seconds` of back-to-back calls
+double embeddingsPerSecond(FaceEmbeddingExtractor& model, const std::vector<cv::Mat>& faces, double seconds) {
+    model.getEmbeddings(faces);  // warm-up: arena growth, first-run kernels
+    size_t embedded = 0;
+    auto start = Clock::now();
+    double elapsed = 0.0;
+    do {
+        embedded += model.getEmbeddings(faces).size();
+        elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+    } while (elapsed < seconds);
+    return embedded / elapsed;
+}
+
+std::vector<cv::Mat> batchOf(const PairSet& set, int size, const cv::Mat& fallback) {
+    std::vector<cv::Mat> faces;
+    for (int i = 0; i < size; ++i)
+        faces.push_back(set.images.empty() ? fallback : set.images[i % set.images.size()]);
+    return faces;
+}
+
+// Verification rate at each FAR: the threshold lets through that fraction
+// of impostor pairs, and TAR is the fraction of genuine pairs above it
+json verificationAccuracy(FaceEmbeddingExtractor& model, const PairSet& set) {
+    std::vector<std::vector<float>> embeddings;
+    embeddings.reserve(set.images.size());
+    for (size_t i = 0; i < set.images.size(); i += 64) {
+        std::vector<cv::Mat> chunk(set.images.begin() + i, set.images.begin() + std::min(i + 64, set.images.size()));
+        for (auto& embedding : model.getEmbeddings(chunk))
+            embeddings.push_back(std::move(embedding));
+    }
+
+    auto scores = [&](const std::vector<std::pair<size_t, size_t>>& pairs) {
+        std::vector<float> result;
+        for (const auto& [a, b] : pairs)
+            result.push_back(model.compareEmbeddings(embeddings[a], embeddings[b]));
+        return result;
+    };
+    std::vector<float> genuine = scores(set.genuine);
+    std::vector<float> impostor = scores(set.impostor);
+    std::sort(impostor.begin(), impostor.end(), std::greater<float>());
+
+    json result = {{"genuine_pairs", genuine.size()}, {"impostor_pairs", impostor.size()}, {"tar_at_far", json::array()}};
+    for (double far : kFalseAcceptRates) {
+        // Too few impostors to resolve this rate
+        size_t rank = static_cast<size_t>(std::floor(far * impostor.size()));
+        if (rank == 0 || genuine.empty())
+            continue;
+        float threshold = impostor[rank - 1];
+        size_t accepted = std::count_if(genuine.begin(), genuine.end(), [&](float s) { return s > threshold; });
+        result["tar_at_far"].push_back({{"far", far}, {"threshold", threshold},
+                                        {"tar", static_cast<double>(accepted) / genuine.size()}});
+    }
+    return result;
+}
+
+json measureModel(const ModelSpec& spec, const PairSet& set, const Settings& settings) {
+    const std::string& path = spec.path;
+    const TensorNormalization& normalization = normalizationFor(spec);
+    json result = {{"model", path}, {"preprocessing", spec.preprocessing}};
+    OrtRuntime::instance().setModelCacheDirectory(settings.modelCache);
+    const Counter& cacheHits = MetricsRegistry::instance().counter("model_cache_hits");
+    const size_t rssBefore = residentMemoryBytes();
+
+    auto loadStart = Clock::now();
+    FaceEmbeddingExtractor model(path, 1, normalization);
+    result["load_ms"] = std::chrono::duration<double, std::milli>(Clock::now() - loadStart).count();
+    // Whether load_ms was a cold optimization or a load of the cached copy
+    result["model_cache"] = settings.modelCache.empty() ? json("off")
+                          : json(cacheHits.value() > 0 ? "hit" : "miss");
+    result["rss_after_load_bytes"] = static_cast<int64_t>(residentMemoryBytes()) - static_cast<int64_t>(rssBefore);
+    result["input"] = {{"width", model.inputWidth()}, {"height", model.inputHeight()}};
+    result["embedding_size"] = model.embeddingSize();
+    result["dynamic_batch"] = model.supportsBatching();
+
+    cv::Mat fallback(model.inputHeight(), model.inputWidth(), CV_8UC3, cv::Scalar(90, 120, 160));
+    auto firstStart = Clock::now();
+    model.getEmbedding(set.images.empty() ? fallback : set.images.front());
+    result["first_inference_ms"] = std::chrono::duration<double, std::milli>(Clock::now() - firstStart).count();
+
+    json batches = json::array();
+    for (int size : settings.batchSizes) {
+        double rate = embeddingsPerSecond(model, batchOf(set, size, fallback), settings.seconds);
+        batches.push_back({{"batch", size}, {"embeddings_per_second", rate}});
+    }
+    result["batches"] = batches;
+
+    json threads = json::array();
+    for (int count : settings.threadCounts) {
+        FaceEmbeddingExtractor threaded(path, count, normalization);
+        double rate = embeddingsPerSecond(threaded, batchOf(set, settings.scalingBatch, fallback), settings.seconds);
+        threads.push_back({{"threads", count}, {"embeddings_per_second", rate}});
+    }
+    result["threads"] = threads;
+
+    if (!set.genuine.empty() && !set.impostor.empty()) {
+        FaceEmbeddingExtractor threaded(path, settings.threadCounts.empty() ? 1 : settings.threadCounts.back(),
+                                        normalization);
+        result["accuracy"] = verificationAccuracy(threaded, set);
+    }
+
+    rusage usage{};
+    ::getrusage(RUSAGE_SELF, &usage);
+    result["peak_rss_bytes"] = static_cast<uint64_t>(usage.ru_maxrss) * 1024;
+    return result;
+}
+
+// Runs measureModel() in a child process and reads its result back over a pipe
+json measureIsolated(const ModelSpec& spec, const PairSet& set, const Settings& settings) {
+    const std::string& path = spec.path;
+    int fds[2];
+    if (::pipe(fds) < 0)
+        return {{"model", path}, {"error", "pipe() failed"}};
+    std::cout.flush();
+    pid_t child = ::fork();
+    if (child < 0) {
+        ::close(fds[0]);
+        ::close(fds[1]);
+        return {{"model", path}, {"error", "fork() failed"}};
+    }
+    if (child == 0) {
+        ::close(fds[0]);
+        json result;
+        try {
+            result = measureModel(spec, set, settings);
+        } catch (const std::exception& e) {
+            result = {{"model", path}, {"error", e.what()}};
+        }
+        std::string text = result.dump();
+        size_t written = 0;
+        while (written < text.size()) {
+            ssize_t n = ::write(fds[1], text.data() + written, text.size() - written);
+            if (n <= 0)
+                break;
+            written += static_cast<size_t>(n);
+        }
+        ::_exit(0);
+    }
+
+    ::close(fds[1]);
+    std::string text;
+    char chunk[4096];
+    ssize_t n;
+    while ((n = ::read(fds[0], chunk, sizeof(chunk))) > 0)
+        text.append(chunk, static_cast<size_t>(n));
+    ::close(fds[0]);
+    int status = 0;
+    ::waitpid(child, &status, 0);
+
+    json result = json::parse(text, nullptr, false);
+    if (result.is_discarded())
+        return {{"model", path}, {"error", "measurement process exited with status " + std::to_string(status)}};
+    return result;
+}
+
+void printResult(const json& result) {
+    std::cout << "\n" << result["model"].get<std::string>() << "\n";
+    if (result.contains("error")) {
+        std::cout << "  failed: " << result["error"].get<std::string>() << "\n";
+        return;
+    }
+    std::cout << std::fixed << std::setprecision(1)
+              << "  input " << result["input"]["width"] << "x" << result["input"]["height"]
+              << ", " << result["preprocessing"].get<std::string>() << " preprocessing, "
+              << result["embedding_size"] << "-d embedding, "
+              << (result["dynamic_batch"].get<bool>() ? "dynamic batch" : "fixed batch") << "\n"
+              << "  load " << result["load_ms"].get<double>() << " ms (model cache "
+              << result["model_cache"].get<std::string>() << "), first inference "
+              << result["first_inference_ms"].get<double>() << " ms\n"
+              << "  memory: +" << result["rss_after_load_bytes"].get<int64_t>() / (1024 * 1024)
+              << " MiB after load, peak " << result["peak_rss_bytes"].get<uint64_t>() / (1024 * 1024) << " MiB\n";
+    std::cout << "  embeddings/s by batch:";
+    for (const json& batch : result["batches"])
+        std::cout << "  " << batch["batch"] << ": " << batch["embeddings_per_second"].get<double>();
+    std::cout << "\n  embeddings/s by threads:";
+    for (const json& threads : result["threads"])
+        std::cout << "  " << threads["threads"] << ": " << threads["embeddings_per_second"].get<double>();
+    std::cout << "\n";
+    if (result.contains("accuracy")) {
+        const json& accuracy = result["accuracy"];
+        std::cout << std::setprecision(4) << "  " << accuracy["genuine_pairs"] << " genuine / "
+                  << accuracy["impostor_pairs"] << " impostor pairs:";
+        for (const json& point : accuracy["tar_at_far"])
+            std::cout << "  TAR@FAR=" << point["far"].get<double>() << " " << point["tar"].get<double>();
+        std::cout << "\n";
+    }
+}
+
+void printUsage() {
+    std::cerr <<
+        "Usage: facereco-model-bench [model.onnx[@facenet|@imagenet]...] [options]\n"
+        "\n"
+        "Models default to models/faceNet.onnx and models/resnet50_Opset18.onnx. Each\n"
+        "is fed the input it was trained on: BGR in [0, 1] (facenet) or RGB with\n"
+        "ImageNet mean and std (imagenet, assumed for files named resnet*).\n"
+        "\n"
+        "  --faces <dir>          Labeled faces, one subdirectory per identity\n"
+        "  --pairs <file>         Or explicit pairs: \"<image> <image> <1|0>\" per line\n"
+        "  --max-pairs <n>        Cap on genuine and on impostor pairs (default 3000)\n"
+        "  --batches <a,b,..>     Batch sizes (default 1,2,4,8,16,32,64)\n"
+        "  --threads <a,b,..>     Intra-op thread counts (default 1,2,4,.. up to all cores)\n"
+        "  --scaling-batch <n>    Batch size for the thread scaling runs (default 16)\n"
+        "  --seconds <s>          Duration of each throughput run (default 1)\n"
+        "  --seed <n>             For drawing impostor pairs (default 1)\n"
+        "  --model-cache <dir>    Load through the optimized-model cache in <dir> (default: off)\n"
+        "  --json <file|->        Also write the results as JSON\n";
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    std::vector<ModelSpec> models;
+    std::map<std::string, std::string> flags;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg.rfind("--", 0) != 0) {
+            models.push_back(parseModel(arg));
+            continue;
+        }
+        std::string value;
+        if (i + 1 < argc && std::string(argv[i + 1]).rfind("--", 0) != 0)
+            value = argv[++i];
+        flags[arg.substr(2)] = value;
+    }
+    auto get = [&](const std::string& name, const std::string& fallback) {
+        auto it = flags.find(name);
+        return it == flags.end() ? fallback : it->second;
+    };
+    if (flags.count("help")) {
+        printUsage();
+        return 0;
+    }
+    if (models.empty())
+        models = {parseModel("models/faceNet.onnx"), parseModel("models/resnet50_Opset18.onnx")};
+
+    Settings settings;
+    if (flags.count("batches"))
+        settings.batchSizes = parseList(get("batches", ""));
+    if (flags.count("threads")) {
+        settings.threadCounts = parseList(get("threads", ""));
+    } else {
+        const int cores = static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+        for (int count = 1; count < cores; count *= 2)
+            settings.threadCounts.push_back(count);
+        settings.threadCounts.push_back(cores);
+    }
+    settings.scalingBatch = std::stoi(get("scaling-batch", "16"));
+    settings.seconds = std::stod(get("seconds", "1"));
+    settings.modelCache = get("model-cache", "");
+
+    // Decoded once here and shared with every measurement process
+    PairSet set;
+    const size_t maxPairs = std::stoul(get("max-pairs", "3000"));
+    if (flags.count("faces"))
+        set = pairsFromDirectory(get("faces", ""), maxPairs, static_cast<unsigned>(std::stoul(get("seed", "1"))));
+    else if (flags.count("pairs"))
+        set = pairsFromFile(get("pairs", ""));
+    if (flags.count("faces") || flags.count("pairs"))
+        std::cout << set.images.size() << " images, " << set.genuine.size() << " genuine and "
+                  << set.impostor.size() << " impostor pairs\n";
+    else
+        std::cout << "No --faces or --pairs: measuring speed only, on a synthetic image\n";
+
+    json results = json::array();
+    for (const ModelSpec& model : models) {
+        json result = measureIsolated(model, set, settings);
+        printResult(result);
+        results.push_back(std::move(result));
+    }
+
+    if (flags.count("json")) {
+        std::string path = get("json", "-");
+        if (path == "-" || path.empty()) {
+            std::cout << results.dump(2) << "\n";
+        } else {
+            std::ofstream out(path);
+            out << results.dump(2) << "\n";
+            if (!out) {
+                std::cerr << "Cannot write " << path << "\n";
+                return 1;
+            }
+        }
+    }
+    return std::all_of(results.begin(), results.end(), [](const json& r) { return !r.contains("error"); }) ? 0 : 1;
+}
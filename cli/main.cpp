@@ -0,0 +1,799 @@
+#include "batch_runner.hpp"
+#include "face_quality.hpp"
+#include "gallery.hpp"
+#include "match_server.hpp"
+#include "match_service.hpp"
+#include "metrics_export.hpp"
+#include "shard_coordinator.hpp"
+#include "stream_manager.hpp"
+#include "onnx_face_compare.hpp"
+#include "result_exporter.hpp"
+#include "thread_pool.hpp"
+#include "trace.hpp"
+#include <opencv2/imgcodecs.hpp>
+#include <nlohmann/json.hpp>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cctype>
+#include <csignal>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace fs = std::filesystem;
+using json = nlohmann::json;
+
+namespace {
+
+struct Options {
+    std::vector<std::string> positional;
+    std::map<std::string, std::string> flags;
+
+    std::string get(const std::string& name, const std::string& fallback = "") const {
+        auto it = flags.find(name);
+        return it == flags.end() ? fallback : it->second;
+    }
+    bool has(const std::string& name) const { return flags.count(name) != 0; }
+};
+
+// --name value pairs and bare positional arguments, starting after the subcommand
+Options parseOptions(int argc, char** argv) {
+    Options options;
+    for (int i = 2; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg.rfind("--", 0) == 0) {
+            std::string name = arg.substr(2);
+            std::string value;
+            size_t eq = name.find('=');
+            if (eq != std::string::npos) {
+                value = name.substr(eq + 1);
+                name = name.substr(0, eq);
+            } else if (i + 1 < argc && std::string(argv[i + 1]).rfind("--", 0) != 0) {
+                value = argv[++i];
+            }
+            options.flags[name] = value;
+        } else {
+            options.positional.push_back(arg);
+        }
+    }
+    return options;
+}
+
+// Upper bounds for thread and queue options; far beyond any useful
+// setting, but low enough that a typo cannot exhaust the process
+constexpr long long kMaxThreads = 1024;
+constexpr long long kMaxQueue = 1 << 20;
+constexpr long long kMaxDeadlineMs = 3600 * 1000;
+
+// A whole number within [min, max] given for --name. Anything else,
+// including trailing characters or a value that would wrap around as
+// unsigned, is reported and leaves `value` alone.
+bool parseCount(const std::string& name, const std::string& text, long long min, long long max, long long& value) {
+    size_t used = 0;
+    long long parsed = 0;
+    try {
+        parsed = std::stoll(text, &used);
+    } catch (const std::exception&) {
+        used = 0;
+    }
+    if (used == 0 || used != text.size() || parsed < min || parsed > max) {
+        std::cerr << "--" << name << " must be a whole number from " << min << " to " << max << "\n";
+        return false;
+    }
+    value = parsed;
+    return true;
+}
+
+// Same for an option; `value` holds the default, kept when it is absent
+bool countOption(const Options& options, const std::string& name, long long min, long long max, long long& value) {
+    return !options.has(name) || parseCount(name, options.get(name), min, max, value);
+}
+
+void printUsage() {
+    std::cerr <<
+        "Usage: facereco-cli <command> [options]\n"
+        "\n"
+        "Commands:\n"
+        "  enroll <image> --id <id> --gallery <file>     Add one face to a gallery\n"
+        "  index <dir> --gallery <file>                  Embed every image under a directory\n"
+        "        [--quality-gate]                         skipping blurred, tiny or badly exposed photos\n"
+        "  query <image> --gallery <file>                Rank gallery identities for a face\n"
+        "        [--top-k 5] [--threshold 0.5]\n"
+        "  scan-dir <dir> --reference <image>            Stream images matching a reference face\n"
+        "        [--threshold 0.75] [--output -|file.csv|file.jsonl]\n"
+        "  batch <requests.jsonl|->                      Run JSON Lines queries on a worker pool\n"
+        "        [--gallery <file>] [--top-k 5] [--threshold 0.5] [--output -|file.jsonl]\n"
+        "  serve --socket <path> [--gallery <file>]      Keep the model and gallery resident and\n"
+        "        [--queue 256] [--deadline-ms 0]          answer requests over a Unix socket\n"
+        "        [--processes 1] [--mmap]                 pre-fork workers sharing a mapped gallery\n"
+        "  shard <gallery> --shards <n>                  Split a gallery into <gallery>.0 .. <gallery>.<n-1>\n"
+        "  coordinate --socket <path> --shards <a,b,..>  Scatter queries over shard services and merge\n"
+        "        [--deadline-ms 1000]                     top-k, returning partial results on timeout\n"
+        "  watch <video|/dev/videoN|index>...            Detect and identify faces in video files or\n"
+        "        [--gallery <file>] [--threshold 0.5]     cameras, one JSON line per processed frame\n"
+        "        [--cascade <xml>] [--ring 2]             (files play at native speed, dropping frames\n"
+        "        [--every-frame] [--output -|file.jsonl]  like a camera unless --every-frame is given)\n"
+        "        [--reembed 30] [--no-tracking]           faces are tracked and embedded once per track,\n"
+        "                                                 refreshed every --reembed frames\n"
+        "        [--priority 2,1,..] [--batch 16]         several sources share one batched embedding\n"
+        "        [--embed-threads 1]                      queue, weighted per source by --priority\n"
+        "        [--motion 0.01] [--no-motion-gate]       frames with less activity reuse the last faces\n"
+        "        [--no-quality-gate]                      faces failing the quality gate are not embedded\n"
+        "\n"
+        "Common options:\n"
+        "  --model <path>     ONNX embedding model (default models/faceNet.onnx)\n"
+        "  --threads <n>      Worker threads (default: all cores)\n"
+        "  --min-face <px>    Quality gate: smallest usable face (default 48)\n"
+        "  --min-sharpness <v>  Quality gate: minimum Laplacian variance (default 40)\n"
+        "  --server <path>    Send enroll/query to a running 'serve' instead of loading the model,\n"
+        "                     waiting up to --deadline-ms (default 1000) for the answer\n"
+        "  --metrics-port <n> Serve Prometheus metrics on http://127.0.0.1:<n>/metrics while running\n"
+        "  --metrics-json <file|->  Write stage latency percentiles and counters as JSON on exit\n"
+        "  --trace <file>     Record spans per image, batch and stage as a Chrome trace (Perfetto)\n"
+        "  --trace-ort        With --trace, also merge ONNX Runtime's per-node profile\n";
+}
+
+bool isImageFile(const fs::path& path) {
+    std::string ext = path.extension().string();
+    std::transform(ext.begin(), ext.end(), ext.begin(), [](unsigned char c) { return std::tolower(c); });
+    return ext == ".jpg" || ext == ".jpeg" || ext == ".png" || ext == ".bmp" ||
+           ext == ".webp" || ext == ".tif" || ext == ".tiff";
+}
+
+std::vector<fs::path> listImages(const std::string& dir) {
+    std::vector<fs::path> files;
+    std::error_code ec;
+    for (fs::recursive_directory_iterator it(dir, ec), end; !ec && it != end; it.increment(ec)) {
+        if (it->is_regular_file() && isImageFile(it->path()))
+            files.push_back(it->path());
+    }
+    std::sort(files.begin(), files.end());
+    return files;
+}
+
+std::vector<float> embedFile(FaceEmbeddingExtractor& extractor, const std::string& path) {
+    static Histogram& decodeTime = MetricsRegistry::instance().histogram("decode_ms");
+    auto start = std::chrono::steady_clock::now();
+    cv::Mat img = cv::imread(path, cv::IMREAD_COLOR);
+    decodeTime.record(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+    if (img.empty()) {
+        std::cerr << "Failed to load image: " << path << "\n";
+        return {};
+    }
+    return extractor.getEmbedding(img);
+}
+
+QualityThresholds qualityThresholds(const Options& options) {
+    QualityThresholds thresholds;
+    thresholds.minFaceSize = std::stoi(options.get("min-face", std::to_string(thresholds.minFaceSize)));
+    thresholds.minSharpness = std::stof(options.get("min-sharpness", std::to_string(thresholds.minSharpness)));
+    return thresholds;
+}
+
+int runEnroll(FaceEmbeddingExtractor& extractor, const Options& options) {
+    if (options.positional.size() != 1 || !options.has("id") || !options.has("gallery")) {
+        printUsage();
+        return 2;
+    }
+    std::string galleryPath = options.get("gallery");
+
+    Gallery gallery;
+    if (fs::exists(galleryPath) && !gallery.load(galleryPath))
+        return 1;
+
+    std::vector<float> embedding = embedFile(extractor, options.positional[0]);
+    if (!gallery.add(options.get("id"), embedding)) {
+        std::cerr << "Could not enroll " << options.positional[0] << "\n";
+        return 1;
+    }
+    return gallery.save(galleryPath) ? 0 : 1;
+}
+
+int runIndex(FaceEmbeddingExtractor& extractor, const Options& options, ThreadPool& pool) {
+    if (options.positional.size() != 1 || !options.has("gallery")) {
+        printUsage();
+        return 2;
+    }
+    const std::string& dir = options.positional[0];
+    std::vector<fs::path> files = listImages(dir);
+
+    // Blurred, tiny or badly exposed photos would only add noise to the
+    // gallery. The gate is opt-in here: it scores the whole photo rather than
+    // a detected face crop, so framing and background can fail good faces.
+    FaceQualityScorer scorer(qualityThresholds(options));
+    bool gate = options.has("quality-gate");
+
+    std::vector<std::future<std::vector<float>>> embeddings;
+    embeddings.reserve(files.size());
+    for (const auto& file : files) {
+        std::string path = file.string();
+        embeddings.push_back(pool.submit([&extractor, &scorer, gate, path]() -> std::vector<float> {
+            cv::Mat img = cv::imread(path, cv::IMREAD_COLOR);
+            if (img.empty()) {
+                std::cerr << "Failed to load image: " << path << "\n";
+                return {};
+            }
+            if (gate) {
+                FaceQuality quality = scorer.assess(img);
+                if (!quality.acceptable()) {
+                    std::cerr << "Rejected " << path << ": " << FaceQuality::name(quality.verdict) << "\n";
+                    return {};
+                }
+            }
+            return extractor.getEmbedding(img);
+        }));
+    }
+
+    Gallery gallery(extractor.embeddingSize());
+    for (size_t i = 0; i < files.size(); ++i) {
+        std::string id = fs::relative(files[i], dir).replace_extension().generic_string();
+        std::vector<float> embedding = embeddings[i].get();
+        if (embedding.empty())
+            continue;
+        if (!gallery.add(id, embedding))
+            std::cerr << "Skipped " << files[i].string() << "\n";
+    }
+    if (scorer.rejected())
+        std::cerr << "Quality gate rejected " << scorer.rejected() << " images\n";
+    std::cerr << "Indexed " << gallery.size() << " of " << files.size() << " images\n";
+    return gallery.save(options.get("gallery")) ? 0 : 1;
+}
+
+int runQuery(FaceEmbeddingExtractor& extractor, const Options& options) {
+    if (options.positional.size() != 1 || !options.has("gallery")) {
+        printUsage();
+        return 2;
+    }
+    Gallery gallery;
+    if (!gallery.load(options.get("gallery")))
+        return 1;
+
+    std::vector<float> embedding = embedFile(extractor, options.positional[0]);
+    if (embedding.empty())
+        return 1;
+
+    size_t topK = std::stoul(options.get("top-k", "5"));
+    float threshold = std::stof(options.get("threshold", "0.5"));
+    for (const auto& match : gallery.query(embedding, topK, threshold))
+        std::cout << json{{"id", match.id}, {"score", match.score}}.dump() << "\n";
+    return 0;
+}
+
+int runScanDir(FaceEmbeddingExtractor& extractor, const Options& options, ThreadPool& pool) {
+    if (options.positional.size() != 1 || !options.has("reference")) {
+        printUsage();
+        return 2;
+    }
+    std::vector<float> reference = embedFile(extractor, options.get("reference"));
+    if (reference.empty())
+        return 1;
+
+    ResultExporter exporter(options.get("output", "-"));
+    if (!exporter.isOpen()) {
+        std::cerr << "Failed to open output: " << options.get("output") << "\n";
+        return 1;
+    }
+
+    float threshold = std::stof(options.get("threshold", "0.75"));
+    std::vector<fs::path> files = listImages(options.positional[0]);
+    std::atomic<size_t> matches{0};
+
+    using Clock = std::chrono::steady_clock;
+    auto elapsedMs = [](Clock::time_point since) {
+        return std::chrono::duration<double, std::milli>(Clock::now() - since).count();
+    };
+
+    // Matches are written by the workers as soon as each image is scored
+    std::vector<std::future<void>> pending;
+    pending.reserve(files.size());
+    for (const auto& file : files) {
+        std::string path = file.string();
+        pending.push_back(pool.submit([&, path] {
+            auto decodeStart = Clock::now();
+            cv::Mat img = cv::imread(path, cv::IMREAD_COLOR);
+            if (img.empty())
+                return;
+            double decodeMs = elapsedMs(decodeStart);
+
+            auto inferenceStart = Clock::now();
+            float similarity = extractor.compareEmbeddings(reference, extractor.getEmbedding(img));
+            double inferenceMs = elapsedMs(inferenceStart);
+            if (similarity <= threshold)
+                return;
+
+            MatchResult result;
+            result.url = path;
+            result.similarity = similarity;
+            result.source = "scan-dir";
+            result.boxWidth = img.cols;
+            result.boxHeight = img.rows;
+            result.decodeMs = decodeMs;
+            result.inferenceMs = inferenceMs;
+            exporter.write(result);
+            ++matches;
+        }));
+    }
+    for (auto& task : pending)
+        task.get();
+
+    std::cerr << matches << " of " << files.size() << " images matched\n";
+    return exporter.flush() ? 0 : 1;
+}
+
+int runBatch(FaceEmbeddingExtractor& extractor, const Options& options, ThreadPool& pool) {
+    if (options.positional.size() != 1) {
+        printUsage();
+        return 2;
+    }
+
+    std::ifstream requestFile;
+    std::istream* requests = &std::cin;
+    if (options.positional[0] != "-") {
+        requestFile.open(options.positional[0]);
+        if (!requestFile.is_open()) {
+            std::cerr << "Failed to open requests: " << options.positional[0] << "\n";
+            return 1;
+        }
+        requests = &requestFile;
+    }
+
+    std::ofstream resultFile;
+    std::ostream* results = &std::cout;
+    std::string output = options.get("output", "-");
+    if (output != "-") {
+        resultFile.open(output, std::ios::trunc);
+        if (!resultFile.is_open()) {
+            std::cerr << "Failed to open output: " << output << "\n";
+            return 1;
+        }
+        results = &resultFile;
+    }
+
+    BatchOptions batchOptions;
+    batchOptions.defaultGallery = options.get("gallery");
+    batchOptions.topK = std::stoul(options.get("top-k", "5"));
+    batchOptions.threshold = std::stof(options.get("threshold", "0.5"));
+
+    BatchRunner runner(extractor, pool);
+    BatchStats stats = runner.run(*requests, *results, batchOptions);
+    std::cerr << stats.queries << " queries, " << stats.failed << " failed\n";
+    return results->good() ? 0 : 1;
+}
+
+json frameJson(const FrameResult& frame) {
+    json faces = json::array();
+    for (const FaceObservation& face : frame.faces) {
+        json entry = {{"box", {face.box.x, face.box.y, face.box.width, face.box.height}},
+                      {"score", face.score},
+                      {"embedded", face.embedded}};
+        if (face.trackId)
+            entry["track"] = face.trackId;
+        entry["quality"] = face.quality;
+        if (face.verdict != FaceQuality::Accepted)
+            entry["rejected"] = FaceQuality::name(face.verdict);
+        if (!face.id.empty())
+            entry["id"] = face.id;
+        faces.push_back(std::move(entry));
+    }
+    return {{"frame", frame.frameIndex},
+            {"t_ms", frame.streamMs},
+            {"skipped", frame.skipped},
+            {"activity", frame.activity},
+            {"faces", std::move(faces)},
+            {"timings_ms", {{"detect", frame.detectMs},
+                            {"embed", frame.embedMs},
+                            {"match", frame.matchMs},
+                            {"latency", frame.latencyMs}}}};
+}
+
+StreamManager* runningStreams = nullptr;
+
+void stopStreams(int) {
+    if (runningStreams)
+        runningStreams->stop();
+}
+
+int runWatch(FaceEmbeddingExtractor& extractor, const Options& options) {
+    if (options.positional.empty()) {
+        printUsage();
+        return 2;
+    }
+
+    long long maxBatch = 16, embedThreads = 1;
+    if (!countOption(options, "batch", 1, 1024, maxBatch) ||
+        !countOption(options, "embed-threads", 1, kMaxThreads, embedThreads))
+        return 2;
+
+    // --priority 2,1,1 weights the sources in order; unlisted ones get 1
+    std::vector<unsigned> priorities;
+    std::string list = options.get("priority");
+    for (size_t start = 0; start < list.size();) {
+        size_t comma = std::min(list.find(',', start), list.size());
+        long long priority = 1;
+        if (!parseCount("priority", list.substr(start, comma - start), 1, 1000, priority))
+            return 2;
+        priorities.push_back(static_cast<unsigned>(priority));
+        start = comma + 1;
+    }
+
+    Gallery gallery(extractor.embeddingSize());
+    if (options.has("gallery") && !gallery.load(options.get("gallery")))
+        return 1;
+
+    std::ofstream resultFile;
+    std::ostream* results = &std::cout;
+    std::string output = options.get("output", "-");
+    if (output != "-") {
+        resultFile.open(output, std::ios::trunc);
+        if (!resultFile.is_open()) {
+            std::cerr << "Failed to open output: " << output << "\n";
+            return 1;
+        }
+        results = &resultFile;
+    }
+
+    // --every-frame analyses files offline: no pacing and no dropped frames
+    bool everyFrame = options.has("every-frame");
+    bool multiple = options.positional.size() > 1;
+
+    StreamManagerOptions streamOptions;
+    streamOptions.cascadePath = options.get("cascade", kDefaultCascadePath);
+    streamOptions.paced = !everyFrame;
+    streamOptions.video.ringCapacity = std::stoul(options.get("ring", "2"));
+    streamOptions.video.dropFrames = !everyFrame;
+    streamOptions.video.threshold = std::stof(options.get("threshold", "0.5"));
+    streamOptions.video.tracking = !options.has("no-tracking");
+    streamOptions.video.tracker.reembedInterval = std::stoi(options.get("reembed", "30"));
+    streamOptions.video.motionGating = !options.has("no-motion-gate");
+    streamOptions.video.motion.threshold = std::stof(options.get("motion", "0.01"));
+    streamOptions.video.qualityGate = !options.has("no-quality-gate");
+    streamOptions.video.quality = qualityThresholds(options);
+    streamOptions.queue.maxBatch = static_cast<size_t>(maxBatch);
+    streamOptions.queue.workers = static_cast<size_t>(embedThreads);
+    // A lone stream has nothing to batch with
+    if (!multiple)
+        streamOptions.queue.maxWait = std::chrono::microseconds(0);
+
+    StreamManager streams(extractor, gallery, streamOptions);
+    for (size_t i = 0; i < options.positional.size(); ++i) {
+        StreamConfig config;
+        config.source = options.positional[i];
+        config.priority = i < priorities.size() ? priorities[i] : 1;
+        if (!streams.addStream(config))
+            return 1;
+    }
+
+    runningStreams = &streams;
+    std::signal(SIGINT, stopStreams);
+    std::signal(SIGTERM, stopStreams);
+
+    std::vector<VideoStats> stats = streams.run([&](size_t stream, const FrameResult& frame) {
+        json line = frameJson(frame);
+        if (multiple)
+            line["stream"] = streams.name(stream);
+        *results << line.dump() << "\n";
+    });
+    runningStreams = nullptr;
+
+    for (size_t i = 0; i < stats.size(); ++i) {
+        if (multiple)
+            std::cerr << streams.name(i) << ": ";
+        std::cerr << stats[i].captured << " frames captured, " << stats[i].processed << " processed, "
+                  << stats[i].dropped << " dropped, " << stats[i].skipped << " static; "
+                  << stats[i].lowQuality << " low-quality faces skipped, "
+                  << stats[i].embeddings << " embeddings for "
+                  << stats[i].faces << " faces; latency mean " << stats[i].meanLatencyMs
+                  << " ms, max " << stats[i].maxLatencyMs << " ms\n";
+    }
+    const EmbeddingQueue& queue = streams.embeddingQueue();
+    if (multiple && queue.batches())
+        std::cerr << queue.embedded() << " embeddings in " << queue.batches() << " batches\n";
+    return results->good() ? 0 : 1;
+}
+
+MatchServer* runningServer = nullptr;
+
+void stopServer(int) {
+    if (runningServer)
+        runningServer->stop();
+}
+
+int runServe(FaceEmbeddingExtractor& extractor, const Options& options) {
+    if (!options.has("socket")) {
+        printUsage();
+        return 2;
+    }
+
+    // With several processes the gallery is mapped read-only and shared
+    const long long maxProcesses = 4 * std::max(1u, std::thread::hardware_concurrency());
+    long long processes = 1;
+    long long threads = 0, queue = 256, deadlineMs = 0;
+    if (!countOption(options, "processes", 1, maxProcesses, processes) ||
+        !countOption(options, "threads", 0, kMaxThreads, threads) ||
+        !countOption(options, "queue", 1, kMaxQueue, queue) ||
+        !countOption(options, "deadline-ms", 0, kMaxDeadlineMs, deadlineMs))
+        return 2;
+    bool shared = processes > 1 || options.has("mmap");
+
+    std::string galleryPath = options.get("gallery");
+    Gallery gallery(extractor.embeddingSize());
+    if (!galleryPath.empty() && fs::exists(galleryPath)) {
+        bool loaded = shared ? gallery.map(galleryPath) : gallery.load(galleryPath);
+        if (!loaded)
+            return 1;
+    }
+
+    ServerOptions serverOptions;
+    serverOptions.socketPath = options.get("socket");
+    serverOptions.workers = static_cast<size_t>(threads);
+    if (serverOptions.workers == 0 && processes > 1)
+        serverOptions.workers = std::max<size_t>(1, std::thread::hardware_concurrency() / static_cast<size_t>(processes));
+    serverOptions.queueCapacity = static_cast<size_t>(queue);
+    serverOptions.defaultDeadlineMs = static_cast<int>(deadlineMs);
+
+    MatchService service(extractor, std::move(gallery), galleryPath);
+    service.setReadOnly(shared);
+    MatchServer server(service, serverOptions);
+    if (!server.listen())
+        return 1;
+
+    runningServer = &server;
+    std::signal(SIGINT, stopServer);
+    std::signal(SIGTERM, stopServer);
+    std::cerr << "Serving on " << serverOptions.socketPath;
+    if (processes > 1) {
+        std::cerr << " with " << processes << " worker processes\n";
+        server.servePreforked(static_cast<size_t>(processes));
+    } else {
+        std::cerr << "\n";
+        server.serve();
+    }
+    runningServer = nullptr;
+
+    if (!shared && !galleryPath.empty() && !service.saveGallery())
+        return 1;
+    return 0;
+}
+
+int runShard(const Options& options) {
+    if (options.positional.size() != 1 || !options.has("shards")) {
+        printUsage();
+        return 2;
+    }
+    long long shardCount = 1;
+    if (!countOption(options, "shards", 1, 4096, shardCount))
+        return 2;
+
+    Gallery gallery;
+    if (!gallery.load(options.positional[0]))
+        return 1;
+
+    std::vector<Gallery> parts = gallery.partition(static_cast<size_t>(shardCount));
+    for (size_t i = 0; i < parts.size(); ++i) {
+        std::string path = options.positional[0] + "." + std::to_string(i);
+        if (!parts[i].save(path))
+            return 1;
+        std::cerr << path << ": " << parts[i].size() << " identities\n";
+    }
+    return 0;
+}
+
+int runCoordinate(FaceEmbeddingExtractor& extractor, const Options& options) {
+    if (!options.has("socket") || !options.has("shards")) {
+        printUsage();
+        return 2;
+    }
+
+    std::vector<std::string> shardSockets;
+    std::string list = options.get("shards");
+    for (size_t start = 0; start <= list.size();) {
+        size_t comma = std::min(list.find(',', start), list.size());
+        if (comma > start)
+            shardSockets.push_back(list.substr(start, comma - start));
+        start = comma + 1;
+    }
+    if (shardSockets.empty()) {
+        std::cerr << "--shards needs at least one shard socket\n";
+        return 2;
+    }
+
+    long long threads = 0, queue = 256, deadlineMs = 1000;
+    if (!countOption(options, "threads", 0, kMaxThreads, threads) ||
+        !countOption(options, "queue", 1, kMaxQueue, queue) ||
+        !countOption(options, "deadline-ms", 0, kMaxDeadlineMs, deadlineMs))
+        return 2;
+
+    ShardCoordinator coordinator(extractor, shardSockets, std::chrono::milliseconds(deadlineMs));
+
+    ServerOptions serverOptions;
+    serverOptions.socketPath = options.get("socket");
+    serverOptions.workers = static_cast<size_t>(threads);
+    serverOptions.queueCapacity = static_cast<size_t>(queue);
+
+    MatchServer server(coordinator, serverOptions);
+    if (!server.listen())
+        return 1;
+
+    runningServer = &server;
+    std::signal(SIGINT, stopServer);
+    std::signal(SIGTERM, stopServer);
+    std::cerr << "Coordinating " << shardSockets.size() << " shards on " << serverOptions.socketPath << "\n";
+    server.serve();
+    runningServer = nullptr;
+    return 0;
+}
+
+// enroll/query against a running server; the model is never loaded here
+int runRemote(const std::string& command, const Options& options) {
+    if (options.positional.size() != 1) {
+        printUsage();
+        return 2;
+    }
+
+    // The server drops the request once this passes, and the client stops
+    // waiting for it, so a hung server cannot block the command
+    long long deadlineMs = 1000;
+    if (!countOption(options, "deadline-ms", 1, kMaxDeadlineMs, deadlineMs))
+        return 2;
+
+    json request = {{"op", command}, {"image", fs::absolute(options.positional[0]).string()},
+                    {"deadline_ms", deadlineMs}};
+    if (command == "enroll") {
+        request["id"] = options.get("id");
+    } else {
+        long long topK = 5;
+        if (!countOption(options, "top-k", 1, 100000, topK))
+            return 2;
+        float threshold = 0.5f;
+        size_t used = 0;
+        const std::string text = options.get("threshold", "0.5");
+        try {
+            threshold = std::stof(text, &used);
+        } catch (const std::exception&) {
+            used = 0;
+        }
+        if (used == 0 || used != text.size()) {
+            std::cerr << "--threshold must be a number\n";
+            return 2;
+        }
+        request["top_k"] = topK;
+        request["threshold"] = threshold;
+    }
+
+    MatchClient client;
+    if (!client.connect(options.get("server"))) {
+        std::cerr << "Cannot connect to " << options.get("server") << "\n";
+        return 1;
+    }
+
+    json response;
+    if (!client.call(request, response, std::chrono::milliseconds(deadlineMs))) {
+        std::cerr << (client.isConnected() ? "Connection to server lost\n"
+                                           : "No response from server within --deadline-ms\n");
+        return 1;
+    }
+    if (response.contains("error")) {
+        std::cerr << response["error"].get<std::string>() << "\n";
+        return 1;
+    }
+    if (command == "query") {
+        for (const auto& match : response["matches"])
+            std::cout << match.dump() << "\n";
+    }
+    return 0;
+}
+
+bool writeMetricsJson(const std::string& path) {
+    std::string text = metricsJson(MetricsRegistry::instance().snapshot()).dump(2) + "\n";
+    if (path == "-") {
+        std::cout << text;
+        return true;
+    }
+    std::ofstream out(path);
+    out << text;
+    if (!out) {
+        std::cerr << "Cannot write metrics to " << path << "\n";
+        return false;
+    }
+    return true;
+}
+
+int runCommand(const std::string& command, const Options& options) {
+    if (command == "shard")
+        return runShard(options);
+
+    try {
+        if (options.has("server") && (command == "enroll" || command == "query"))
+            return runRemote(command, options);
+
+        FaceEmbeddingExtractor extractor(options.get("model", kDefaultModelPath));
+
+        if (command == "enroll")
+            return runEnroll(extractor, options);
+        if (command == "query")
+            return runQuery(extractor, options);
+        if (command == "serve")
+            return runServe(extractor, options);
+        if (command == "coordinate")
+            return runCoordinate(extractor, options);
+        if (command == "watch")
+            return runWatch(extractor, options);
+
+        // Only the bulk commands start a worker per core
+        long long threads = 0;
+        if (!countOption(options, "threads", 0, kMaxThreads, threads))
+            return 2;
+        ThreadPool pool(static_cast<size_t>(threads));
+        if (command == "index")
+            return runIndex(extractor, options, pool);
+        if (command == "batch")
+            return runBatch(extractor, options, pool);
+        return runScanDir(extractor, options, pool);
+    } catch (const Ort::Exception& e) {
+        std::cerr << "Failed to load ONNX model: " << e.what() << "\n";
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << "\n";
+    }
+    return 1;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        printUsage();
+        return 2;
+    }
+    std::string command = argv[1];
+    Options options = parseOptions(argc, argv);
+
+    if (command != "enroll" && command != "index" && command != "query" && command != "scan-dir" &&
+        command != "batch" && command != "serve" && command != "shard" && command != "coordinate" &&
+        command != "watch") {
+        printUsage();
+        return 2;
+    }
+
+    // Scrapable for as long as the command runs. Not offered with pre-forked
+    // serve workers: they keep their own metrics, and forking while the
+    // server thread runs could leave a child holding one of its locks.
+    std::unique_ptr<MetricsServer> metricsServer;
+    if (options.has("metrics-port")) {
+        int port = 0;
+        try {
+            port = std::stoi(options.get("metrics-port"));
+        } catch (const std::exception&) {
+        }
+        if (port < 1 || port > 65535) {
+            std::cerr << "--metrics-port must be a port number between 1 and 65535\n";
+            return 2;
+        }
+        if (command == "serve" && options.get("processes", "1") != "1") {
+            std::cerr << "--metrics-port cannot be combined with --processes\n";
+            return 2;
+        }
+        metricsServer = std::make_unique<MetricsServer>(port);
+        if (!metricsServer->start())
+            return 1;
+    }
+
+    if (options.has("trace")) {
+        Tracer::instance().start(options.get("trace"), options.has("trace-ort"));
+        Tracer::instance().nameThread("main");
+    }
+
+    // The extractor is gone by the time runCommand() returns, so its ORT
+    // profile has been handed to the tracer
+    int status = runCommand(command, options);
+    if (options.has("trace") && !Tracer::instance().stop() && status == 0)
+        status = 1;
+    if (options.has("metrics-json") && !writeMetricsJson(options.get("metrics-json")) && status == 0)
+        status = 1;
+    return status;
+}
@@ -0,0 +1,48 @@
+#pragma once
+#include <condition_variable>
+#include <cstddef>
+#include <istream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include "gallery.hpp"
+
+class FaceEmbeddingExtractor;
+class ThreadPool;
+
+struct BatchOptions {
+    std::string defaultGallery;   // used when a request has no "gallery"
+    size_t topK = 5;
+    float threshold = 0.5f;
+    size_t maxInFlight = 0;       // 0: four queries per pool thread
+};
+
+struct BatchStats {
+    size_t queries = 0;
+    size_t failed = 0;
+};
+
+// Runs face queries read as JSON Lines, one object per line:
+//   {"id": "q1", "image": "probe.jpg", "gallery": "people.gal", "top_k": 5, "threshold": 0.5}
+// Queries are spread over a thread pool that shares one model session and one
+// copy of each gallery. Results are written as JSON Lines in completion order:
+//   {"id": "q1", "image": "...", "matches": [{"id": ..., "score": ...}], "timings_ms": {...}}
+// and failures as {"id": "q1", "error": "..."}.
+class BatchRunner {
+public:
+    BatchRunner(FaceEmbeddingExtractor& extractor, ThreadPool& pool);
+
+    BatchStats run(std::istream& requests, std::ostream& results, const BatchOptions& options);
+
+private:
+    // Loads each gallery once; returns nullptr if it could not be read.
+    const Gallery* gallery(const std::string& path);
+
+    FaceEmbeddingExtractor& extractor;
+    ThreadPool& pool;
+
+    std::mutex galleryMutex;
+    std::map<std::string, std::unique_ptr<Gallery>> galleries;
+};
@@ -1,25 +1,75 @@
 #pragma once
+#include <atomic>
 #include <string>
 #include <vector>
-#include <utility>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include "match_result.hpp"
+
+namespace cv { class Mat; }
+class HttpClient;
+
+// Legacy raw-tensor helpers: a 160x160 NHWC input tensor, and the cosine
+// similarity of two embeddings that need not be normalized
+std::vector<float> preprocessFace(const cv::Mat& img);
+float cosineSimilarity(const std::vector<float>& a, const std::vector<float>& b);
+
+// Decoded img_url= targets of a Yandex results page, in page order
+std::vector<std::string> findImageUrls(const std::string& html);
 
 class Crawler {
 public:
     Crawler(const std::string& path);
+    ~Crawler();
     void startSearch();
+    // Safe to call from any thread; downloads in flight are aborted
     void stopSearch();
+    bool stopped() const;
+    // Checks the given image URLs against the reference instead of asking
+    // a search engine for candidates, e.g. for a local mirror or a benchmark
+    void scanUrls(const std::vector<std::string>& urls, const std::string& source);
     void downloadResults(const std::string& outPath);
     
     // Add getter method for matched images
-    std::vector<std::pair<std::string, float>> getMatchedImages() const;
+    std::vector<MatchResult> getMatchedImages() const;
+
+    // Called from the crawling thread for every match as soon as it is found,
+    // e.g. to stream results into a ResultExporter.
+    void setMatchCallback(std::function<void(const MatchResult&)> callback);
+
+    // Embedding of the reference face when the caller already has one; the
+    // reference image is then not decoded again.
+    void setReferenceEmbedding(std::vector<float> embedding);
+
+    // Client to download with, e.g. one kept alive across searches so its
+    // connections are reused. Must outlive the crawler; by default the
+    // crawler makes its own.
+    void setHttpClient(HttpClient* client);
+
+    // Upper bound on the bytes of thumbnails kept in memory for reports.
+    void setThumbnailBudget(size_t bytes);
+
+    // Width reports draw matched images at; thumbnails are kept at this size.
+    static constexpr int kThumbnailWidth = 300;
 
 private:
     std::string inputImagePath;
-    bool stopFlag;
-    std::vector<std::pair<std::string, float>> matchedImages;
+    std::vector<float> reference;
+    std::atomic<bool> stopFlag;
+    HttpClient* http = nullptr;
+    std::unique_ptr<HttpClient> ownedHttp;
+    std::vector<MatchResult> matchedImages;
+    size_t thumbnailBudget = 32 * 1024 * 1024;
+    size_t thumbnailBytes = 0;
+    std::function<void(const MatchResult&)> matchCallback;
     
+    HttpClient& client();
+    bool loadReference();
+    void checkCandidates(const std::vector<std::string>& urls, const std::string& source, int maxMatches);
     void crawlSurfaceWeb();
     void crawlDeepWeb();
     void crawlDarkWeb();
-    bool imageMatches(const std::string& url);
-};
\ No newline at end of file
+    bool imageMatches(const std::string& url, const std::string& source);
+    std::vector<unsigned char> makeThumbnail(const cv::Mat& img, const std::string& encoded);
+};
@@ -0,0 +1,72 @@
+#pragma once
+#include "onnx_face_compare.hpp"
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <future>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class Gauge;
+
+struct EmbeddingQueueOptions {
+    size_t maxBatch = 16;
+    // How long a worker waits for a partial batch to fill before running it
+    std::chrono::microseconds maxWait{2000};
+    size_t workers = 1;
+};
+
+// One inference queue shared by many video streams. Face crops from every
+// stream are collected into batches for FaceEmbeddingExtractor, so the
+// model runs fewer, larger inferences however many feeds are attached.
+//
+// Each stream submits into its own lane. Batches are filled by weighted
+// round-robin over the lanes: a lane with priority p contributes up to p
+// crops per round, so a busy stream gets at most its share and cannot
+// starve quieter ones.
+class EmbeddingQueue {
+public:
+    explicit EmbeddingQueue(FaceEmbeddingExtractor& extractor, EmbeddingQueueOptions options = {});
+    ~EmbeddingQueue();
+
+    EmbeddingQueue(const EmbeddingQueue&) = delete;
+    EmbeddingQueue& operator=(const EmbeddingQueue&) = delete;
+
+    // Returns the lane id to submit with
+    int addStream(unsigned priority = 1);
+
+    std::future<std::vector<float>> submit(int stream, cv::Mat face);
+
+    uint64_t batches() const;
+    uint64_t embedded() const;
+
+private:
+    struct Request {
+        cv::Mat face;
+        std::promise<std::vector<float>> result;
+    };
+    struct Lane {
+        unsigned priority = 1;
+        std::deque<Request> pending;
+    };
+
+    void workerLoop();
+    std::vector<Request> takeBatch();
+
+    FaceEmbeddingExtractor& extractor;
+    EmbeddingQueueOptions options;
+    Gauge& depth;   // crops waiting, summed over every queue in the process
+
+    mutable std::mutex mutex;
+    std::condition_variable ready;
+    std::deque<Lane> lanes;
+    size_t cursor = 0;
+    size_t pendingTotal = 0;
+    bool stopping = false;
+    uint64_t batchCount = 0;
+    uint64_t embeddingCount = 0;
+
+    std::vector<std::thread> workers;
+};
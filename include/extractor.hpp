@@ -7,6 +7,7 @@ struct ImageFeatures {
     std::vector<float> faceEmbedding;
     QString material;
     QString color;
+    std::vector<float> colorHistogram;  // 64 bins, 4 levels per channel, sums to 1
     // Add more properties as needed
 };
 
@@ -0,0 +1,35 @@
+#pragma once
+#include <opencv2/core.hpp>
+#include <opencv2/objdetect.hpp>
+#include <string>
+#include <vector>
+
+constexpr const char* kDefaultCascadePath = "models/haarcascade_frontalface_default.xml";
+
+// Finds faces in a BGR frame with a Haar cascade. Without a cascade the
+// whole frame is returned as a single face, which matches how still images
+// are handled elsewhere (the upload is assumed to be a face crop).
+//
+// Not thread-safe: use one detector per stream.
+class FaceDetector {
+public:
+    explicit FaceDetector(const std::string& cascadePath = kDefaultCascadePath);
+
+    bool hasCascade() const { return !cascade.empty(); }
+
+    // Frames wider than this are downscaled before detection
+    void setMaxWidth(int width) { maxWidth = width; }
+    void setMinFaceSize(int pixels) { minFaceSize = pixels; }
+
+    std::vector<cv::Rect> detect(const cv::Mat& frame);
+
+    // The crop around `face`, enlarged by `margin` and clipped to the frame
+    static cv::Rect expand(const cv::Rect& face, const cv::Size& frame, double margin = 0.2);
+
+private:
+    cv::CascadeClassifier cascade;
+    cv::Mat gray;
+    cv::Mat small;
+    int maxWidth = 640;
+    int minFaceSize = 40;
+};
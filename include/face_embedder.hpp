@@ -1,9 +1,15 @@
 #ifndef FACE_EMBEDDER_HPP
 #define FACE_EMBEDDER_HPP
 
+#include "image_view.hpp"
 #include <opencv2/opencv.hpp>
 #include <vector>
 
 std::vector<float> extractEmbeddingFromImage(const cv::Mat& image);
+std::vector<float> extractEmbeddingFromImage(const ImageView& image);
+
+// Loads the shared model now, e.g. on a background thread at startup, so
+// the first embedding does not pay for it. Returns false if it failed.
+bool preloadFaceEmbedder();
 
 #endif  // FACE_EMBEDDER_HPP
@@ -0,0 +1,53 @@
+#pragma once
+#include <opencv2/core.hpp>
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+struct QualityThresholds {
+    int minFaceSize = 48;          // shorter side of the crop, pixels
+    float minSharpness = 40.0f;    // Laplacian variance at the analysis size
+    float minBrightness = 40.0f;   // mean gray level
+    float maxBrightness = 220.0f;
+    float minSymmetry = 0.3f;      // left/right correlation; low for turned heads
+};
+
+struct FaceQuality {
+    enum Verdict { Accepted, TooSmall, Blurry, TooDark, TooBright, Turned, VerdictCount };
+
+    Verdict verdict = Accepted;
+    int size = 0;
+    float sharpness = 0.0f;
+    float brightness = 0.0f;
+    float symmetry = 0.0f;
+    float score = 0.0f;            // 0..1, higher is a better view
+
+    bool acceptable() const { return verdict == Accepted; }
+    static const char* name(Verdict verdict);
+};
+
+// Cheap checks run on a face crop before it is embedded, so blurred,
+// tiny, badly exposed or strongly turned faces never cost an inference or
+// end up in a gallery. Crops are scored at a fixed 64x64 so sharpness is
+// comparable between near and distant faces. Without a landmark model,
+// pose is approximated by how well the left half of the face mirrors the
+// right half.
+//
+// assess() is thread-safe; counters cover every crop assessed.
+class FaceQualityScorer {
+public:
+    explicit FaceQualityScorer(QualityThresholds thresholds = {});
+
+    FaceQuality assess(const cv::Mat& face) const;
+
+    uint64_t assessed() const { return assessedCount; }
+    uint64_t rejected(FaceQuality::Verdict verdict) const { return counts[verdict]; }
+    uint64_t rejected() const;
+
+    const QualityThresholds& thresholds() const { return limits; }
+
+private:
+    QualityThresholds limits;
+    mutable std::atomic<uint64_t> assessedCount{0};
+    mutable std::array<std::atomic<uint64_t>, FaceQuality::VerdictCount> counts{};
+};
@@ -0,0 +1,65 @@
+#pragma once
+#include <opencv2/core.hpp>
+#include <opencv2/video/tracking.hpp>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+struct TrackerOptions {
+    float iouThreshold = 0.3f;   // minimum overlap to continue a track
+    int maxMisses = 15;          // frames a track survives without a detection
+    int reembedInterval = 30;    // frames before a track's embedding is refreshed
+    float qualityGain = 1.25f;   // re-embed early when a face is this much better
+};
+
+struct Track {
+    int id = 0;
+    cv::Rect box;                  // last corrected position
+    int hits = 0;
+    int misses = 0;
+    uint64_t lastEmbedFrame = 0;
+    float bestQuality = 0.0f;
+
+    std::vector<float> embedding;  // L2-normalized mean of all samples
+    size_t samples = 0;
+    std::string identity;          // set by the caller after matching
+    float score = 0.0f;
+
+    cv::KalmanFilter filter;
+    std::vector<float> sum;        // unnormalized sum of samples
+};
+
+// SORT-style multi-face tracker: a constant-velocity Kalman filter per track
+// predicts where each face moves, and detections are greedily assigned to
+// the prediction they overlap most. Embedding every face on every frame is
+// the expensive part of video matching, so the tracker also decides when a
+// track needs an embedding: once on creation, then only when the current
+// one is stale or a noticeably better view of the face turns up.
+class FaceTracker {
+public:
+    explicit FaceTracker(TrackerOptions options = {});
+
+    // Advances one frame. Returns the id of the track each detection was
+    // assigned to, creating tracks for unmatched detections.
+    std::vector<int> update(const std::vector<cv::Rect>& detections);
+
+    // Whether a track should be embedded given the quality of its current face
+    bool wantsEmbedding(int trackId, float quality) const;
+
+    // Folds an embedding into the track's aggregate
+    void addEmbedding(int trackId, const std::vector<float>& embedding, float quality);
+
+    Track* find(int trackId);
+    const std::vector<Track>& tracks() const { return active; }
+    void reset();
+
+    static float iou(const cv::Rect& a, const cv::Rect& b);
+
+private:
+    Track makeTrack(const cv::Rect& box);
+
+    TrackerOptions options;
+    std::vector<Track> active;
+    uint64_t frame = 0;
+    int nextId = 1;
+};
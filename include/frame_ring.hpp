@@ -0,0 +1,101 @@
+#pragma once
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+#include <optional>
+#include <vector>
+
+// Fixed-capacity ring buffer between a producer that must never block (a
+// camera) and a slower consumer. When full, push() overwrites the oldest
+// entry; popLatest() hands out the newest entry and discards anything older,
+// so the consumer always works on the freshest frame and latency stays
+// bounded no matter how far behind it falls.
+template <typename T>
+class FrameRing {
+public:
+    explicit FrameRing(size_t capacity) : slots(capacity ? capacity : 1) {}
+
+    void push(T item) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (count == slots.size()) {
+                ++droppedCount;
+                head = (head + 1) % slots.size();
+                --count;
+            }
+            slots[(head + count) % slots.size()] = std::move(item);
+            ++count;
+        }
+        ready.notify_one();
+    }
+
+    // Waits for space instead of overwriting; for sources that must not lose data.
+    void pushBlocking(T item) {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            space.wait(lock, [this] { return closed || count < slots.size(); });
+            if (closed)
+                return;
+            slots[(head + count) % slots.size()] = std::move(item);
+            ++count;
+        }
+        ready.notify_one();
+    }
+
+    // Blocks until an item is available; empty once closed and drained.
+    std::optional<T> popLatest() {
+        std::unique_lock<std::mutex> lock(mutex);
+        ready.wait(lock, [this] { return closed || count > 0; });
+        if (count == 0)
+            return std::nullopt;
+        droppedCount += count - 1;
+        size_t newest = (head + count - 1) % slots.size();
+        std::optional<T> item(std::move(slots[newest]));
+        head = 0;
+        count = 0;
+        space.notify_all();
+        return item;
+    }
+
+    // Blocks until an item is available and returns the oldest one.
+    std::optional<T> popOldest() {
+        std::unique_lock<std::mutex> lock(mutex);
+        ready.wait(lock, [this] { return closed || count > 0; });
+        if (count == 0)
+            return std::nullopt;
+        std::optional<T> item(std::move(slots[head]));
+        head = (head + 1) % slots.size();
+        --count;
+        space.notify_one();
+        return item;
+    }
+
+    void close() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            closed = true;
+        }
+        ready.notify_all();
+        space.notify_all();
+    }
+
+    size_t dropped() const {
+        std::lock_guard<std::mutex> lock(mutex);
+        return droppedCount;
+    }
+
+    size_t size() const {
+        std::lock_guard<std::mutex> lock(mutex);
+        return count;
+    }
+
+private:
+    std::vector<T> slots;
+    size_t head = 0;
+    size_t count = 0;
+    size_t droppedCount = 0;
+    bool closed = false;
+    mutable std::mutex mutex;
+    std::condition_variable ready;
+    std::condition_variable space;
+};
@@ -0,0 +1,76 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <string_view>
+#include <vector>
+
+struct GalleryMatch {
+    std::string id;
+    float score = 0.0f;
+};
+
+// Enrolled identities and their L2-normalized embeddings, stored as one
+// contiguous row-major float matrix so queries are a straight scan.
+//
+// On-disk layout (host byte order):
+//   [0, 64)        header: "FRGL", version, dim, reserved, count, idsOffset
+//   [64, ...)      count * dim float32 embeddings
+//   [idsOffset, )  count * (uint32 length + id bytes)
+//
+// A gallery is either loaded into private memory or mapped read-only with
+// map(), in which case every process mapping the same file shares one copy
+// of the embeddings through the page cache. Adding to a mapped gallery
+// first copies it into private memory.
+class Gallery {
+public:
+    Gallery() = default;
+    explicit Gallery(size_t dim);
+    ~Gallery();
+
+    Gallery(Gallery&& other) noexcept;
+    Gallery& operator=(Gallery&& other) noexcept;
+    Gallery(const Gallery&) = delete;
+    Gallery& operator=(const Gallery&) = delete;
+
+    // Returns false if the embedding size does not match the gallery.
+    bool add(const std::string& id, const std::vector<float>& embedding);
+
+    size_t size() const { return ids.size(); }
+    size_t dim() const { return dimension; }
+    std::string_view id(size_t index) const { return ids[index]; }
+    const float* embedding(size_t index) const { return data + index * dimension; }
+    bool isMapped() const { return mapping != nullptr; }
+
+    // Best `topK` identities scoring at least `threshold`, highest first.
+    std::vector<GalleryMatch> query(const std::vector<float>& embedding, size_t topK, float threshold) const;
+
+    bool save(const std::string& path) const;
+    bool load(const std::string& path);
+    bool map(const std::string& path);
+
+    // Shard an identity belongs to when a gallery is split `shards` ways.
+    // Stable across runs and platforms (FNV-1a of the id).
+    static size_t shardFor(std::string_view id, size_t shards);
+
+    // Splits the gallery into `shards` galleries by shardFor().
+    std::vector<Gallery> partition(size_t shards) const;
+
+    static constexpr uint32_t kVersion = 1;
+    static constexpr size_t kHeaderSize = 64;
+
+private:
+    void unmap();
+    void makePrivate();
+
+    size_t dimension = 0;
+    std::vector<std::string_view> ids;     // into ownedIds or the mapping
+    const float* data = nullptr;           // ownedEmbeddings or the mapping
+
+    std::deque<std::string> ownedIds;      // deque keeps views stable on growth
+    std::vector<float> ownedEmbeddings;
+
+    void* mapping = nullptr;
+    size_t mappingSize = 0;
+};
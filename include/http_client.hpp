@@ -0,0 +1,48 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <vector>
+
+typedef void CURL;
+
+// One libcurl easy handle reused for every request. Keeping the handle
+// keeps its connection, TLS session and DNS caches, so repeated downloads
+// from the same hosts skip the handshakes. Not thread-safe: use one client
+// per thread. Nothing of libcurl is set up until the first request, so
+// constructing a client costs nothing at startup.
+class HttpClient {
+public:
+    HttpClient();
+    ~HttpClient();
+
+    HttpClient(const HttpClient&) = delete;
+    HttpClient& operator=(const HttpClient&) = delete;
+
+    // Both return false on transport errors; see lastError()
+    bool get(const std::string& url, std::string& body);
+    bool post(const std::string& url, const std::string& data,
+              const std::vector<std::string>& headers, std::string& body);
+
+    // A transfer in progress is aborted as soon as *flag becomes true.
+    // Pass nullptr to detach.
+    void setCancelFlag(const std::atomic<bool>* flag);
+
+    // Limits for establishing a connection and for a whole request,
+    // redirects included, so a stalled server cannot hang a scan. Zero
+    // keeps libcurl's own default (300 s to connect, no overall limit).
+    // Defaults: 10 s to connect, 30 s per request.
+    void setTimeouts(std::chrono::milliseconds connect, std::chrono::milliseconds total);
+
+    const std::string& lastError() const { return error; }
+
+private:
+    CURL* curl = nullptr;
+    const std::atomic<bool>* cancel = nullptr;
+    std::chrono::milliseconds connectTimeout{10000};
+    std::chrono::milliseconds totalTimeout{30000};
+    std::string error;
+
+    bool ensureHandle();
+    bool perform(const std::string& url, std::string& body);
+};
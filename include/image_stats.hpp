@@ -0,0 +1,22 @@
+#pragma once
+#include "image_view.hpp"
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+// Colour statistics of an 8-bit interleaved image, gathered in one pass.
+struct ImageStats {
+    double meanR = 0.0;
+    double meanG = 0.0;
+    double meanB = 0.0;
+    // Mean squared 3x3 Laplacian of the luma, as cv::Laplacian (ksize 1,
+    // reflect-101 borders) would give; high for textured images
+    double laplacianEnergy = 0.0;
+    // 4 levels per channel, index (r >> 6) * 16 + (g >> 6) * 4 + (b >> 6)
+    std::array<uint32_t, 64> histogram{};
+};
+
+// Reads every pixel once: colour sums, the histogram and luma are taken
+// per row, and the Laplacian is evaluated over three rolling luma rows, so
+// no full-resolution intermediate image is ever allocated.
+ImageStats computeImageStats(const ImageView& image);
@@ -0,0 +1,54 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+// Byte offsets of each channel within a pixel
+struct PixelLayout {
+    int bytesPerPixel = 4;
+    int r = 2;
+    int g = 1;
+    int b = 0;
+};
+
+// Non-owning view of 8-bit interleaved pixels: a cv::Mat, a QImage or any
+// other decoded buffer, read in place without conversion.
+struct ImageView {
+    const uint8_t* data = nullptr;
+    int width = 0;
+    int height = 0;
+    size_t stride = 0;        // bytes per row
+    PixelLayout layout;
+
+    bool empty() const { return !data || width <= 0 || height <= 0; }
+};
+
+namespace layouts {
+constexpr PixelLayout Bgr{3, 2, 1, 0};
+constexpr PixelLayout Rgb{3, 0, 1, 2};
+constexpr PixelLayout Bgra{4, 2, 1, 0};
+constexpr PixelLayout Rgba{4, 0, 1, 2};
+constexpr PixelLayout Argb{4, 1, 2, 3};
+constexpr PixelLayout Gray{1, 0, 0, 0};
+}  // namespace layouts
+
+// What a model expects of its input: channel order, and per channel (in
+// that order) the value (pixel / 255 - mean) / stddev.
+struct TensorNormalization {
+    bool rgb = false;
+    float mean[3] = {0.0f, 0.0f, 0.0f};
+    float stddev[3] = {1.0f, 1.0f, 1.0f};
+};
+
+namespace normalizations {
+// The FaceNet export in models/: BGR in [0, 1]
+constexpr TensorNormalization FaceNet{};
+// torchvision ImageNet classifiers such as ResNet-50
+constexpr TensorNormalization ImageNet{true, {0.485f, 0.456f, 0.406f}, {0.229f, 0.224f, 0.225f}};
+}  // namespace normalizations
+
+// Bilinear resize to width x height, channel reorder, normalization and
+// NHWC or NCHW packing in a single pass from the source pixels into
+// `tensor` (width * height * 3 floats). Sampling follows cv::resize with
+// INTER_LINEAR (pixel centres aligned, edges clamped).
+void writeTensor(const ImageView& image, int width, int height, bool channelsFirst, float* tensor,
+                 const TensorNormalization& normalization = normalizations::FaceNet);
@@ -0,0 +1,28 @@
+#pragma once
+#include <string>
+#include <vector>
+
+// One matched image as produced by the crawler.
+struct MatchResult {
+    std::string url;
+    float similarity = 0.0f;
+
+    // Where the candidate came from, e.g. "yandex"
+    std::string source;
+
+    // Region of the image that was embedded, in source pixels
+    int boxX = 0;
+    int boxY = 0;
+    int boxWidth = 0;
+    int boxHeight = 0;
+
+    // Per-stage wall time spent on this image
+    double downloadMs = 0.0;
+    double decodeMs = 0.0;
+    double inferenceMs = 0.0;
+
+    // JPEG bytes kept from the download that produced the match, so reports
+    // can be built without fetching the image again. Empty when the crawler's
+    // thumbnail budget was already spent.
+    std::vector<unsigned char> thumbnail;
+};
@@ -0,0 +1,105 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <nlohmann/json.hpp>
+
+class RequestHandler;
+
+struct ServerOptions {
+    std::string socketPath;
+    size_t workers = 0;             // 0: one per core
+    size_t queueCapacity = 256;     // requests beyond this are rejected as "overloaded"
+    int defaultDeadlineMs = 0;      // 0: no deadline unless the request sets "deadline_ms"
+};
+
+// Serves a RequestHandler (MatchService or ShardCoordinator) over a Unix
+// domain socket. Each connection carries newline-delimited JSON requests;
+// responses are written back on the same connection as they complete and
+// echo the request's "seq". Requests wait in one bounded queue for the worker
+// threads, and a request whose deadline has passed by the time a worker
+// picks it up is answered with an error instead of being run.
+class MatchServer {
+public:
+    MatchServer(RequestHandler& service, ServerOptions options);
+    ~MatchServer();
+
+    bool listen();
+    // Blocks until stop() is called.
+    void serve();
+
+    // Forks `processes` children that each serve() on the listening socket
+    // while this process only supervises them, replacing any that die.
+    // Replacements back off, and a worker that keeps dying as soon as it
+    // starts is given up on rather than forked again and again.
+    // Everything loaded before the call (the model session, a mapped
+    // gallery) is shared with the children copy-on-write. Sessions must use
+    // a single intra-op thread, since ORT's pool threads do not survive fork.
+    void servePreforked(size_t processes);
+    // Safe to call from another thread or a signal handler.
+    void stop();
+
+private:
+    struct Connection;
+    struct Job {
+        std::shared_ptr<Connection> connection;
+        nlohmann::json request;
+        std::chrono::steady_clock::time_point deadline;
+        bool hasDeadline = false;
+    };
+
+    void readConnection(std::shared_ptr<Connection> connection);
+    void workerLoop();
+    void respond(Connection& connection, const nlohmann::json& request, nlohmann::json response);
+
+    RequestHandler& service;
+    ServerOptions options;
+    int listenFd = -1;
+    int ownerPid = 0;
+    std::atomic<bool> stopping{false};
+
+    std::mutex queueMutex;
+    std::condition_variable queueReady;
+    std::deque<Job> queue;
+
+    std::mutex connectionsMutex;
+    std::vector<std::weak_ptr<Connection>> connections;
+
+    struct Reader {
+        std::thread thread;
+        std::shared_ptr<std::atomic<bool>> done;
+    };
+    std::vector<Reader> readers;
+    void reapReaders();
+    std::vector<std::thread> workers;
+};
+
+// Synchronous client for MatchServer, used by the CLI and GUI.
+class MatchClient {
+public:
+    MatchClient() = default;
+    ~MatchClient();
+
+    MatchClient(const MatchClient&) = delete;
+    MatchClient& operator=(const MatchClient&) = delete;
+
+    bool connect(const std::string& socketPath);
+    bool isConnected() const { return fd >= 0; }
+
+    // Sends one request and waits for its response. Returns false if the
+    // connection failed; service-side errors come back as {"error": ...}.
+    // With a timeout, gives up once it has passed and closes the
+    // connection, so a late response cannot be taken for the next one's.
+    bool call(const nlohmann::json& request, nlohmann::json& response,
+              std::chrono::milliseconds timeout = std::chrono::milliseconds::max());
+
+private:
+    int fd = -1;
+    std::string pending;
+};
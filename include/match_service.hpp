@@ -0,0 +1,48 @@
+#pragma once
+#include <nlohmann/json.hpp>
+#include <shared_mutex>
+#include <string>
+#include <vector>
+#include "gallery.hpp"
+
+class FaceEmbeddingExtractor;
+
+// Anything MatchServer can serve: one JSON request in, one JSON response out.
+class RequestHandler {
+public:
+    virtual ~RequestHandler() = default;
+    // Must not throw; failures are returned as {"error": message}.
+    virtual nlohmann::json handle(const nlohmann::json& request) = 0;
+};
+
+// Request handling for the resident matching service. Requests and
+// responses are JSON objects; the operation is selected by "op":
+//   {"op": "embed",  "image": path}                          -> {"embedding": [...]}
+//   {"op": "enroll", "id": id, "image": path | "embedding": [...]}
+//   {"op": "query",  "image": path | "embedding": [...], "top_k": 5, "threshold": 0.5}
+//                                                            -> {"matches": [{"id", "score"}]}
+//   {"op": "verify", "image": path | "embedding": [...], "image2": path | "embedding2": [...]}
+//                                                            -> {"score": s}
+//   {"op": "save"}   writes the gallery back to its file
+//   {"op": "ping"}
+// Failures are reported as {"error": message}; handle() never throws.
+class MatchService : public RequestHandler {
+public:
+    MatchService(FaceEmbeddingExtractor& extractor, Gallery gallery, std::string galleryPath = "");
+
+    nlohmann::json handle(const nlohmann::json& request) override;
+    bool saveGallery();
+
+    // Rejects enroll/save, e.g. when worker processes share one mapped gallery
+    // and a private enrollment would make them disagree.
+    void setReadOnly(bool value) { readOnly = value; }
+
+private:
+    std::vector<float> embeddingFor(const nlohmann::json& request, const char* imageKey, const char* embeddingKey);
+
+    FaceEmbeddingExtractor& extractor;
+    std::shared_mutex galleryMutex;
+    Gallery gallery;
+    std::string galleryPath;
+    bool readOnly = false;
+};
@@ -0,0 +1,117 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Metrics are written per thread and merged when read: each thread updates
+// its own cache-line-sized shard, so threads recording the same metric do
+// not contend. Threads are dealt shards round-robin; past kMetricShards
+// threads some share one, which stays correct, only less contention-free.
+constexpr size_t kMetricShards = 8;
+size_t metricShard();
+
+class Counter {
+public:
+    void add(uint64_t n = 1) { shards[metricShard()].count.fetch_add(n, std::memory_order_relaxed); }
+    uint64_t value() const;
+
+private:
+    struct alignas(64) Shard {
+        std::atomic<uint64_t> count{0};
+    };
+    std::array<Shard, kMetricShards> shards;
+};
+
+// A level that goes up and down, e.g. a queue depth
+class Gauge {
+public:
+    void set(int64_t value) { level.store(value, std::memory_order_relaxed); }
+    void add(int64_t delta) { level.fetch_add(delta, std::memory_order_relaxed); }
+    int64_t value() const { return level.load(std::memory_order_relaxed); }
+
+private:
+    std::atomic<int64_t> level{0};
+};
+
+struct HistogramSnapshot {
+    uint64_t count = 0;
+    double sumMs = 0.0;
+    double maxMs = 0.0;
+    std::vector<uint64_t> buckets;
+
+    double meanMs() const { return count ? sumMs / count : 0.0; }
+    // q in [0, 1]; accurate to the bucket width, about 12%
+    double quantile(double q) const;
+};
+
+// Latency distribution in log-linear buckets (HDR histogram layout): every
+// power of two is split into 8 sub-buckets, so any value from a
+// microsecond to hours is kept to within about 12% with fixed memory and
+// a lock-free record(). Shards are summed bucket by bucket on snapshot(),
+// which loses nothing, unlike merging per-thread percentiles.
+class Histogram {
+public:
+    static constexpr int kSubBucketBits = 3;
+    static constexpr int kSubBuckets = 1 << kSubBucketBits;
+    static constexpr int kBucketCount = (64 - kSubBucketBits + 1) * kSubBuckets;
+
+    void record(double ms);
+    HistogramSnapshot snapshot() const;
+
+    // Bucket of a value in microseconds, and the smallest value it holds
+    static int bucketFor(uint64_t micros);
+    static uint64_t bucketStart(int bucket);
+
+private:
+    struct alignas(64) Shard {
+        std::array<std::atomic<uint64_t>, kBucketCount> buckets{};
+        std::atomic<uint64_t> sumMicros{0};
+        std::atomic<uint64_t> maxMicros{0};
+    };
+    std::array<Shard, kMetricShards> shards;
+};
+
+struct MetricsSnapshot {
+    std::map<std::string, uint64_t> counters;
+    std::map<std::string, int64_t> gauges;
+    std::map<std::string, HistogramSnapshot> histograms;
+};
+
+// Named metrics shared by the whole process. Lookups take a lock, so call
+// sites keep the returned reference (e.g. in a function-local static);
+// updating a metric never locks. Metrics live as long as the process.
+//
+// Histograms hold latencies in milliseconds and are named after the
+// pipeline stage they time: download_ms, decode_ms, preprocess_ms,
+// inference_ms, match_ms and report_ms, plus image_ms for one crawler
+// candidate from download to match, and model_load_ms for session creation.
+class MetricsRegistry {
+public:
+    static MetricsRegistry& instance();
+
+    Counter& counter(const std::string& name);
+    Gauge& gauge(const std::string& name);
+    Histogram& histogram(const std::string& name);
+
+    MetricsSnapshot snapshot() const;
+
+    MetricsRegistry(const MetricsRegistry&) = delete;
+    MetricsRegistry& operator=(const MetricsRegistry&) = delete;
+
+private:
+    MetricsRegistry() = default;
+
+    mutable std::mutex mutex;
+    std::map<std::string, std::unique_ptr<Counter>> counters;
+    std::map<std::string, std::unique_ptr<Gauge>> gauges;
+    std::map<std::string, std::unique_ptr<Histogram>> histograms;
+};
+
+// Resident set size of this process in bytes, 0 where unsupported
+size_t residentMemoryBytes();
@@ -0,0 +1,39 @@
+#pragma once
+#include "metrics.hpp"
+#include <atomic>
+#include <string>
+#include <thread>
+#include <nlohmann/json.hpp>
+
+// Prometheus text exposition format. Metric names get a facereco_ prefix;
+// counters end in _total and latency histograms are exported as summaries
+// in seconds (download_ms becomes facereco_download_seconds).
+std::string prometheusText(const MetricsSnapshot& snapshot);
+
+// {"counters": {..}, "gauges": {..}, "histograms": {name: {count, mean_ms,
+// p50_ms, p90_ms, p95_ms, p99_ms, p999_ms, max_ms}}}
+nlohmann::json metricsJson(const MetricsSnapshot& snapshot);
+
+// Plain HTTP on 127.0.0.1 for scrapers: GET /metrics returns
+// prometheusText(), GET /metrics.json returns metricsJson(). Runs on its
+// own thread from start() until stop() or destruction.
+class MetricsServer {
+public:
+    explicit MetricsServer(int port);
+    ~MetricsServer();
+
+    MetricsServer(const MetricsServer&) = delete;
+    MetricsServer& operator=(const MetricsServer&) = delete;
+
+    bool start();
+    void stop();
+
+private:
+    void serve();
+    void answer(int fd);
+
+    int port;
+    int listenFd = -1;
+    std::atomic<bool> stopping{false};
+    std::thread thread;
+};
@@ -0,0 +1,48 @@
+#pragma once
+#include <opencv2/core.hpp>
+
+struct MotionGateOptions {
+    // Activity below this reuses the previous frame's faces
+    float threshold = 0.01f;
+    // Pixel change (0-255) that counts as motion rather than sensor noise
+    int noiseLevel = 12;
+    // Run the full pipeline at least this often even on a static scene
+    int maxSkippedFrames = 30;
+    cv::Size analysisSize{64, 48};
+};
+
+// Decides whether a frame differs enough from the last fully processed one
+// to be worth detecting and embedding. Frames are reduced to a small
+// grayscale thumbnail; activity is the larger of the fraction of pixels
+// that changed beyond the noise level (motion) and the Bhattacharyya
+// distance between intensity histograms (lighting and scene cuts). Both run
+// on OpenCV's vectorized kernels over a few thousand pixels, so the gate
+// costs a tiny fraction of one detection.
+//
+// The reference is only replaced when a frame passes, so slow drift
+// accumulates until it is noticed instead of being compared away.
+class MotionGate {
+public:
+    explicit MotionGate(MotionGateOptions options = {});
+
+    // True if the frame should be processed
+    bool admit(const cv::Mat& frame);
+
+    // Activity score of the last frame passed to admit(), 0..1
+    float activity() const { return lastActivity; }
+
+    void reset();
+
+private:
+    float score();
+
+    MotionGateOptions options;
+    cv::Mat reference;
+    cv::Mat referenceHist;
+    cv::Mat scaled;
+    cv::Mat small;
+    cv::Mat hist;
+    cv::Mat diff;
+    int skipped = 0;
+    float lastActivity = 1.0f;
+};
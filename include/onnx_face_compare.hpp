@@ -0,0 +1,61 @@
+#pragma once
+#include "image_view.hpp"
+#include <onnxruntime_cxx_api.h>
+#include <opencv2/core.hpp>
+#include <string>
+#include <vector>
+
+constexpr const char* kDefaultModelPath = "models/faceNet.onnx";
+
+// Owns one ONNX Runtime session for a face embedding model and keeps it
+// loaded for the lifetime of the object. The input layout (NHWC or NCHW)
+// and size are read from the model, so any single-image embedding model
+// works. getEmbedding() may be called from several threads at once.
+// Models with a dynamic batch dimension embed several faces per Run().
+class FaceEmbeddingExtractor {
+public:
+    // While the Tracer is profiling ORT, the session runs ORT's profiler
+    // and its output is merged into the trace when the extractor is destroyed.
+    // `normalization` is how the model expects its input pixels scaled.
+    explicit FaceEmbeddingExtractor(const std::string& modelPath, int intraOpThreads = 1,
+                                    const TensorNormalization& normalization = normalizations::FaceNet);
+    ~FaceEmbeddingExtractor();
+
+    FaceEmbeddingExtractor(const FaceEmbeddingExtractor&) = delete;
+    FaceEmbeddingExtractor& operator=(const FaceEmbeddingExtractor&) = delete;
+
+    // Returns the L2-normalized embedding of a BGR image.
+    std::vector<float> getEmbedding(const cv::Mat& face);
+
+    // Same, reading the pixels in place from any supported layout
+    std::vector<float> getEmbedding(const ImageView& face);
+
+    // One embedding per face, in one inference call when the model allows it
+    std::vector<std::vector<float>> getEmbeddings(const std::vector<cv::Mat>& faces);
+
+    float compareEmbeddings(const std::vector<float>& a, const std::vector<float>& b) const;
+
+    size_t embeddingSize() const { return outputSize; }
+    int inputWidth() const { return width; }
+    int inputHeight() const { return height; }
+    bool supportsBatching() const { return dynamicBatch; }
+
+private:
+    std::vector<std::vector<float>> run(const ImageView* faces, size_t count);
+
+    Ort::Session session;
+    Ort::MemoryInfo memoryInfo;
+    std::string inputName;
+    std::string outputName;
+    TensorNormalization normalization;
+    bool channelsFirst = false;
+    bool dynamicBatch = false;
+    bool profiling = false;
+    int width = 160;
+    int height = 160;
+    size_t outputSize = 128;
+};
+
+// Process-wide extractor for kDefaultModelPath, created on first use.
+// Throws Ort::Exception if the model cannot be loaded.
+FaceEmbeddingExtractor& defaultFaceEmbedder();
@@ -0,0 +1,60 @@
+#pragma once
+#include <onnxruntime_cxx_api.h>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// What a session is created with. OrtRuntime builds the Ort::SessionOptions
+// from it, so the optimized-model cache can tell sessions apart by it.
+struct SessionSettings {
+    GraphOptimizationLevel optimization = GraphOptimizationLevel::ORT_ENABLE_ALL;
+    int intraOpThreads = 1;
+    std::vector<std::string> executionProviders;    // by name, ahead of the CPU provider
+    std::string profilePrefix;                      // non-empty: run ORT's profiler
+};
+
+// Process-wide ONNX Runtime state: one Ort::Env and one pre-packed weights
+// container. Every session in the process is created through here, so
+// sessions over the same model share their pre-packed (layout-transformed)
+// weights instead of each holding a private copy.
+//
+// Sessions are also created from a cached copy of the model as ORT
+// optimized it, so graph optimization runs once per model rather than at
+// every start. The copy is keyed by the model's contents, the ORT version,
+// the CPU's instruction set extensions and the session settings, since the
+// optimized graph is specific to all of them.
+class OrtRuntime {
+public:
+    static OrtRuntime& instance();
+
+    Ort::Env& env() { return environment; }
+    Ort::Session createSession(const std::string& modelPath, const SessionSettings& settings);
+
+    // Defaults to $FACERECO_MODEL_CACHE, else $XDG_CACHE_HOME/facereco or
+    // ~/.cache/facereco. An empty path turns the cache off.
+    void setModelCacheDirectory(const std::string& path);
+    std::string modelCacheDirectory() const;
+
+    OrtRuntime(const OrtRuntime&) = delete;
+    OrtRuntime& operator=(const OrtRuntime&) = delete;
+
+private:
+    OrtRuntime();
+    ~OrtRuntime();
+
+    // Where the optimized copy of modelPath lives, or "" for no caching
+    std::string cachedModelPath(const std::string& modelPath, const SessionSettings& settings);
+    // contentHashes persists in the cache directory, so a cold start only
+    // hashes models that changed since they were last seen
+    void loadHashIndex();
+    void appendHashIndex(const std::string& stamp, uint64_t hash);
+
+    Ort::Env environment;
+    OrtPrepackedWeightsContainer* prepackedWeights = nullptr;
+
+    mutable std::mutex mutex;
+    std::string cacheDirectory;
+    std::map<std::string, uint64_t> contentHashes;  // path, size and mtime -> hash of the file
+    std::string indexedDirectory;                   // cache directory contentHashes was read from
+};
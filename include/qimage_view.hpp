@@ -0,0 +1,9 @@
+#pragma once
+#include "image_view.hpp"
+#include <QImage>
+
+// Describes the QImage's pixel buffer in place. Returns false for formats
+// that are not 8-bit interleaved RGB/gray (palettes, 16-bit, premultiplied
+// alpha); convert those with QImage::convertToFormat(QImage::Format_RGB32).
+// The view is only valid while `image` is alive and unmodified.
+bool imageViewFor(const QImage& image, ImageView& view);
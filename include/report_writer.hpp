@@ -0,0 +1,58 @@
+#pragma once
+#include <cstddef>
+#include <fstream>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+#include "match_result.hpp"
+
+// A thumbnail ready to be embedded: always baseline/progressive JPEG at
+// (or below) the report width, with its pixel size already known.
+struct ReportImage {
+    std::vector<unsigned char> jpeg;
+    int width = 0;
+    int height = 0;
+    int components = 0;
+};
+
+// Streams matched results into a PDF or HTML report one entry at a time.
+// Pages are written out as soon as they fill, so memory use does not grow
+// with the number of results, and JPEG thumbnails are embedded verbatim.
+class ReportWriter {
+public:
+    enum class Format { Pdf, Html };
+
+    // Picks the format from the file extension (.html/.htm, otherwise PDF).
+    explicit ReportWriter(const std::string& path);
+    ReportWriter(const std::string& path, Format format);
+    ~ReportWriter();
+
+    bool isOpen() const;
+    void add(const MatchResult& result, const ReportImage& image);
+    bool finish();
+
+    static Format formatForPath(const std::string& path);
+
+    // Reads the JPEG header without decoding; false if the bytes are not a JPEG.
+    static bool probeJpeg(const std::vector<unsigned char>& bytes, int& width, int& height, int& components);
+
+    // Passes small JPEGs through untouched and re-encodes anything else at `width`.
+    static ReportImage prepareImage(const std::vector<unsigned char>& bytes, int width);
+
+private:
+    class Backend;
+    class PdfBackend;
+    class HtmlBackend;
+
+    std::ofstream out;
+    std::unique_ptr<Backend> backend;
+    bool finished = false;
+};
+
+using ReportProgress = std::function<void(size_t done, size_t total)>;
+
+// Writes a complete report, preparing thumbnails on a worker pool a window
+// at a time while entries are appended in order. Returns false on I/O errors.
+bool writeReport(const std::vector<MatchResult>& results, const std::string& path,
+                 const ReportProgress& progress = nullptr, int thumbnailWidth = 300);
@@ -0,0 +1,38 @@
+#pragma once
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include "match_result.hpp"
+
+// Appends matched results to a CSV or JSON Lines file as they arrive.
+// Rows are collected in a fixed-size buffer and written in large blocks;
+// write() may be called from several threads.
+class ResultExporter {
+public:
+    enum class Format { Csv, JsonLines };
+
+    // Picks the format from the file extension (.csv, otherwise JSON Lines).
+    // A path of "-" writes to stdout.
+    explicit ResultExporter(const std::string& path);
+    ResultExporter(const std::string& path, Format format);
+    ~ResultExporter();
+
+    ResultExporter(const ResultExporter&) = delete;
+    ResultExporter& operator=(const ResultExporter&) = delete;
+
+    bool isOpen() const;
+    void write(const MatchResult& result);
+    bool flush();
+
+    static Format formatForPath(const std::string& path);
+
+private:
+    void writeBuffer();
+
+    std::FILE* file = nullptr;
+    bool ownsFile = false;
+    bool failed = false;
+    Format format;
+    std::string buffer;
+    std::mutex mutex;
+};
@@ -0,0 +1,76 @@
+#ifndef SCAN_SERVICE_HPP
+#define SCAN_SERVICE_HPP
+
+#include <QObject>
+#include <QString>
+#include <QVector>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "http_client.hpp"
+#include "match_result.hpp"
+
+class Crawler;
+class Gauge;
+
+struct ScanOptions {
+    // Per HTTP request: search pages and every candidate image download
+    std::chrono::milliseconds connectTimeout{10000};
+    std::chrono::milliseconds requestTimeout{30000};
+};
+
+// Runs web scans on one long-lived background thread. The thread, the
+// shared face model and the HTTP connections stay up between scans, so a
+// new scan starts without reloading anything.
+//
+// Only the newest job matters: submitting cancels the scan in progress and
+// drops any that have not started. Signals are emitted from the scan
+// thread; connect with the default connection type so receivers on the
+// GUI thread get them queued.
+class ScanService : public QObject {
+    Q_OBJECT
+
+public:
+    explicit ScanService(QObject* parent = nullptr);
+    explicit ScanService(const ScanOptions& options, QObject* parent = nullptr);
+    // Cancels outstanding work and waits for the scan thread
+    ~ScanService() override;
+
+    // With a reference embedding the image itself is not decoded again.
+    // Returns the id carried by the job's signals.
+    int submit(const QString& imagePath, std::vector<float> referenceEmbedding = {});
+
+    void cancel();
+
+signals:
+    void jobStarted(int job);
+    void matchFound(int job, const MatchResult& match);
+    // Also emitted for jobs dropped before they started
+    void jobFinished(int job, const QVector<MatchResult>& results, bool cancelled);
+
+private:
+    struct Job {
+        int id = 0;
+        QString imagePath;
+        std::vector<float> referenceEmbedding;
+    };
+
+    std::mutex mutex;
+    std::condition_variable ready;
+    std::deque<Job> pending;
+    Crawler* running = nullptr;
+    bool stopping = false;
+    int nextId = 0;
+    Gauge& depth;
+    HttpClient http;  // used by the scan thread only
+    std::thread worker;
+
+    void workerLoop();
+    // Caller holds mutex; returns the ids of the dropped jobs
+    std::vector<int> cancelLocked();
+};
+
+#endif // SCAN_SERVICE_HPP
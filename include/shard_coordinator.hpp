@@ -0,0 +1,38 @@
+#pragma once
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "match_service.hpp"
+#include "thread_pool.hpp"
+
+class MatchClient;
+
+// Fronts a gallery split across several matching services, one per shard
+// (see Gallery::partition). Queries are embedded once here, sent to every
+// shard in parallel, and the per-shard top-k lists are merged with a heap.
+// Shards that have not answered by the deadline are left out and the
+// response is marked "partial". Enrollments go to the shard owning the id.
+//   {"op": "query", ...}  -> {"matches": [...], "shards": n, "responded": m, "partial": bool}
+class ShardCoordinator : public RequestHandler {
+public:
+    ShardCoordinator(FaceEmbeddingExtractor& extractor, std::vector<std::string> shardSockets,
+                     std::chrono::milliseconds defaultDeadline);
+    ~ShardCoordinator() override;
+
+    nlohmann::json handle(const nlohmann::json& request) override;
+
+private:
+    struct Shard;
+
+    nlohmann::json query(nlohmann::json request);
+    // Gives up at `deadline`, so a hung shard cannot hold a pool thread
+    nlohmann::json callShard(Shard& shard, const nlohmann::json& request,
+                             std::chrono::steady_clock::time_point deadline);
+
+    FaceEmbeddingExtractor& extractor;
+    std::vector<std::unique_ptr<Shard>> shards;
+    std::chrono::milliseconds defaultDeadline;
+    ThreadPool pool;
+};
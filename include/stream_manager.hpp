@@ -0,0 +1,63 @@
+#pragma once
+#include "embedding_queue.hpp"
+#include "face_detector.hpp"
+#include "gallery.hpp"
+#include "video_pipeline.hpp"
+#include "video_source.hpp"
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+struct StreamConfig {
+    std::string source;
+    unsigned priority = 1;   // share of each embedding batch relative to other streams
+};
+
+struct StreamManagerOptions {
+    VideoOptions video;
+    EmbeddingQueueOptions queue;
+    std::string cascadePath = kDefaultCascadePath;
+    bool paced = true;       // play files at their native frame rate
+};
+
+// Hosts many video feeds in one process. Every stream keeps its own capture
+// thread, detector, tracker and latest-frame-wins ring, but all face crops
+// go through one shared EmbeddingQueue, where they are batched across
+// streams and scheduled by stream priority.
+class StreamManager {
+public:
+    using FrameCallback = std::function<void(size_t stream, const FrameResult&)>;
+
+    StreamManager(FaceEmbeddingExtractor& extractor, const Gallery& gallery, StreamManagerOptions options = {});
+
+    // Opens the source; false if it cannot be opened
+    bool addStream(const StreamConfig& config);
+    size_t size() const { return streams.size(); }
+    const std::string& name(size_t stream) const { return streams[stream]->config.source; }
+
+    // Runs every stream until all have ended or stop() is called. Callbacks
+    // come from the stream threads but never run concurrently.
+    std::vector<VideoStats> run(const FrameCallback& onFrame);
+
+    // Safe to call from a signal handler
+    void stop();
+
+    const EmbeddingQueue& embeddingQueue() const { return queue; }
+
+private:
+    struct Stream {
+        StreamConfig config;
+        VideoSource source;
+        std::unique_ptr<FaceDetector> detector;
+        std::unique_ptr<VideoPipeline> pipeline;
+    };
+
+    FaceEmbeddingExtractor& extractor;
+    const Gallery& gallery;
+    StreamManagerOptions options;
+    EmbeddingQueue queue;
+    std::vector<std::unique_ptr<Stream>> streams;
+    std::mutex callbackMutex;
+};
@@ -0,0 +1,96 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+struct TraceEvent {
+    const char* name = "";
+    const char* category = "";
+    uint64_t startUs = 0;       // since Tracer::start()
+    uint64_t durationUs = 0;
+    uint32_t thread = 0;
+    uint64_t correlation = 0;   // 0: none
+    int64_t items = -1;         // e.g. a batch size; -1: none
+};
+
+// Collects timed spans and writes them as a Chrome trace (JSON, opens in
+// chrome://tracing and Perfetto). Off by default; while it is off a span
+// costs one relaxed atomic load. Names and categories must be string
+// literals, since only the pointers are kept until the trace is written.
+class Tracer {
+public:
+    static Tracer& instance();
+
+    // Starts collecting; stop() writes everything to `path`. With
+    // profileOrt, FaceEmbeddingExtractors created from now on also run
+    // ORT's profiler, and its events are merged into the same file.
+    void start(const std::string& path, bool profileOrt = false);
+    bool stop();
+
+    bool enabled() const { return active.load(std::memory_order_relaxed); }
+    bool profilingOrt() const { return enabled() && profileOrt; }
+
+    // A finished ORT profile and the session's profiling start time
+    // (Session::GetProfilingStartTimeNs)
+    void addOrtProfile(const std::string& path, uint64_t startNs);
+
+    // Shown as the thread's name in the trace viewer
+    void nameThread(const std::string& name);
+
+    void record(const TraceEvent& event);
+    uint64_t nowUs() const;
+
+    // Small sequential id of the calling thread
+    static uint32_t threadId();
+
+    Tracer(const Tracer&) = delete;
+    Tracer& operator=(const Tracer&) = delete;
+
+private:
+    Tracer() = default;
+
+    struct OrtProfile {
+        std::string path;
+        uint64_t startNs;
+    };
+
+    std::atomic<bool> active{false};
+    bool profileOrt = false;
+    std::string outputPath;
+    std::chrono::steady_clock::time_point epoch;
+    uint64_t epochWallUs = 0;
+
+    std::mutex mutex;
+    std::vector<TraceEvent> events;
+    std::vector<std::pair<uint32_t, std::string>> threadNames;
+    std::vector<OrtProfile> ortProfiles;
+};
+
+// Times the enclosing scope. A span given a correlation id (e.g. one per
+// image or frame) passes it on to every span opened inside it on the same
+// thread, so all the stages of one item can be found together.
+class TraceSpan {
+public:
+    explicit TraceSpan(const char* name, const char* category = "pipeline", uint64_t correlation = 0);
+    ~TraceSpan();
+
+    TraceSpan(const TraceSpan&) = delete;
+    TraceSpan& operator=(const TraceSpan&) = delete;
+
+    void setItems(int64_t count) { items = count; }
+
+private:
+    const char* name;
+    const char* category;
+    uint64_t startUs = 0;
+    uint64_t correlation = 0;
+    uint64_t outer = 0;
+    int64_t items = -1;
+    bool active;
+};
+
+// A fresh id for TraceSpan, unique within the process
+uint64_t newCorrelationId();
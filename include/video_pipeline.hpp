@@ -0,0 +1,113 @@
+#pragma once
+#include "embedding_queue.hpp"
+#include "face_detector.hpp"
+#include "face_quality.hpp"
+#include "face_tracker.hpp"
+#include "gallery.hpp"
+#include "motion_gate.hpp"
+#include "onnx_face_compare.hpp"
+#include "video_source.hpp"
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+struct FaceObservation {
+    cv::Rect box;
+    int trackId = 0;      // 0 when tracking is off
+    bool embedded = false;  // embedding computed on this frame
+    float quality = 0.0f;
+    FaceQuality::Verdict verdict = FaceQuality::Accepted;
+    std::string id;       // best gallery identity, empty if below threshold
+    float score = 0.0f;   // similarity of the best identity
+};
+
+struct FrameResult {
+    uint64_t frameIndex = 0;
+    double streamMs = 0.0;
+    std::vector<FaceObservation> faces;
+    bool skipped = false;     // static frame; faces carried over from the last processed one
+    float activity = 1.0f;
+    size_t embeddings = 0;
+    size_t lowQuality = 0;    // faces not embedded because of the quality gate
+    double detectMs = 0.0;
+    double embedMs = 0.0;
+    double matchMs = 0.0;
+    double latencyMs = 0.0;   // capture to result, including time spent queued
+};
+
+struct VideoStats {
+    uint64_t captured = 0;
+    uint64_t processed = 0;
+    uint64_t dropped = 0;
+    uint64_t skipped = 0;
+    uint64_t lowQuality = 0;
+    uint64_t faces = 0;
+    uint64_t embeddings = 0;
+    double meanLatencyMs = 0.0;
+    double maxLatencyMs = 0.0;
+};
+
+struct VideoOptions {
+    size_t ringCapacity = 2;
+    // Latest frame wins when processing falls behind. Turn off to process
+    // every frame of a file, in which case capture waits for the consumer.
+    bool dropFrames = true;
+    float threshold = 0.5f;
+    // Embed each tracked face once and refresh it occasionally instead of
+    // embedding every face on every frame
+    bool tracking = true;
+    TrackerOptions tracker;
+    // Skip detection on frames that barely differ from the last processed one
+    bool motionGating = true;
+    MotionGateOptions motion;
+    // Never embed blurred, tiny, badly exposed or turned faces
+    bool qualityGate = true;
+    QualityThresholds quality;
+};
+
+// Capture runs on its own thread and feeds a small FrameRing; the calling
+// thread takes the newest frame, detects faces, embeds each one and matches
+// it against the gallery. Because stale frames are discarded rather than
+// queued, end-to-end latency is bounded by one frame's processing time
+// however slow inference is relative to the frame rate.
+//
+// With tracking on, faces are matched through their track's aggregated
+// embedding. A pipeline holds one stream's tracks, so use one per stream.
+class VideoPipeline {
+public:
+    using FrameCallback = std::function<void(const FrameResult&)>;
+
+    VideoPipeline(FaceEmbeddingExtractor& extractor, const Gallery& gallery, VideoOptions options = {});
+
+    // Blocks until the source ends or stop() is called. `onFrame` runs on
+    // the calling thread once per processed frame.
+    VideoStats run(VideoSource& source, FaceDetector& detector, const FrameCallback& onFrame);
+
+    // Send face crops through a shared queue instead of embedding inline
+    void setEmbeddingQueue(EmbeddingQueue* queue, int stream) {
+        embeddingQueue = queue;
+        queueStream = stream;
+    }
+
+    // Safe to call from a signal handler
+    void stop() { stopping = true; }
+
+    // Detect, embed and match one frame
+    FrameResult process(const VideoFrame& frame, FaceDetector& detector);
+
+private:
+    void match(const std::vector<float>& embedding, std::string& id, float& score) const;
+
+    FaceEmbeddingExtractor& extractor;
+    const Gallery& gallery;
+    VideoOptions options;
+    FaceTracker tracker;
+    MotionGate gate;
+    FaceQualityScorer scorer;
+    std::vector<FaceObservation> lastFaces;
+    EmbeddingQueue* embeddingQueue = nullptr;
+    int queueStream = -1;
+    std::atomic<bool> stopping{false};
+};
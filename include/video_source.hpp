@@ -0,0 +1,46 @@
+#pragma once
+#include <opencv2/core.hpp>
+#include <opencv2/videoio.hpp>
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+struct VideoFrame {
+    cv::Mat image;                                   // BGR
+    uint64_t index = 0;                              // position in the stream
+    double streamMs = 0.0;                           // presentation time
+    std::chrono::steady_clock::time_point captured;  // when it was read
+};
+
+// A video file, a V4L2 device (/dev/videoN) or a camera index ("0").
+// Files can be paced to their native frame rate so they behave like a live
+// camera, which is how the real-time path is exercised without hardware.
+class VideoSource {
+public:
+    VideoSource() = default;
+
+    bool open(const std::string& spec);
+    bool isOpen() const { return capture.isOpened(); }
+
+    // Cameras produce frames whether or not anyone keeps up with them
+    bool isLive() const { return live; }
+    double fps() const { return frameRate; }
+    const std::string& name() const { return spec; }
+
+    // Sleep before each read so a file plays back in real time
+    void setPaced(bool paced) { this->paced = paced; }
+
+    // False at end of stream or on a device error
+    bool read(VideoFrame& frame);
+
+    void close();
+
+private:
+    cv::VideoCapture capture;
+    std::string spec;
+    bool live = false;
+    bool paced = false;
+    double frameRate = 0.0;
+    uint64_t nextIndex = 0;
+    std::chrono::steady_clock::time_point started;
+};
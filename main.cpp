@@ -1,12 +1,30 @@
 #include <QApplication>
 #include <QMetaType>
 #include "include/result_data.hpp"
+#include "include/match_result.hpp"
+#include "include/trace.hpp"
 #include "ui/mainwindow.hpp"
 
 int main(int argc, char *argv[]) {
     qRegisterMetaType<QVector<ResultData>>("QVector<ResultData>");
+    qRegisterMetaType<MatchResult>("MatchResult");
+    qRegisterMetaType<QVector<MatchResult>>("QVector<MatchResult>");
     QApplication app(argc, argv);
-    MainWindow w;
-    w.show();
-    return app.exec();
+
+    // FACERECO_TRACE=<file> records a Chrome trace of the session
+    QString tracePath = qEnvironmentVariable("FACERECO_TRACE");
+    if (!tracePath.isEmpty()) {
+        Tracer::instance().start(tracePath.toStdString());
+        Tracer::instance().nameThread("gui");
+    }
+
+    int status;
+    {
+        MainWindow w;
+        w.show();
+        status = app.exec();
+    }
+    if (!tracePath.isEmpty())
+        Tracer::instance().stop();
+    return status;
 }
\ No newline at end of file
@@ -0,0 +1,141 @@
+#include "batch_runner.hpp"
+#include "onnx_face_compare.hpp"
+#include "thread_pool.hpp"
+#include "metrics.hpp"
+#include "trace.hpp"
+#include <opencv2/imgcodecs.hpp>
+#include <nlohmann/json.hpp>
+#include <chrono>
+
+using json = nlohmann::json;
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+double elapsedMs(Clock::time_point since) {
+    return std::chrono::duration<double, std::milli>(Clock::now() - since).count();
+}
+
+}  // namespace
+
+BatchRunner::BatchRunner(FaceEmbeddingExtractor& extractor, ThreadPool& pool)
+    : extractor(extractor), pool(pool) {}
+
+const Gallery* BatchRunner::gallery(const std::string& path) {
+    std::lock_guard<std::mutex> lock(galleryMutex);
+    auto it = galleries.find(path);
+    if (it == galleries.end()) {
+        auto loaded = std::make_unique<Gallery>();
+        if (!loaded->load(path))
+            loaded.reset();
+        it = galleries.emplace(path, std::move(loaded)).first;
+    }
+    return it->second.get();
+}
+
+BatchStats BatchRunner::run(std::istream& requests, std::ostream& results, const BatchOptions& options) {
+    BatchStats stats;
+    const size_t maxInFlight = options.maxInFlight ? options.maxInFlight : pool.size() * 4;
+
+    std::mutex mutex;
+    std::condition_variable slotFree;
+    size_t inFlight = 0;
+
+    // Called by workers; lines go out in the order queries finish
+    auto writeResult = [&](const json& line, bool failed) {
+        std::string text = line.dump(-1, ' ', false, json::error_handler_t::replace);
+        std::lock_guard<std::mutex> lock(mutex);
+        results << text << '\n';
+        if (failed)
+            ++stats.failed;
+        --inFlight;
+        slotFree.notify_one();
+    };
+
+    std::string line;
+    size_t lineNumber = 0;
+    while (std::getline(requests, line)) {
+        ++lineNumber;
+        if (line.find_first_not_of(" \t\r") == std::string::npos)
+            continue;
+
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            slotFree.wait(lock, [&] { return inFlight < maxInFlight; });
+            ++inFlight;
+            ++stats.queries;
+        }
+
+        auto queued = Clock::now();
+        pool.submit([this, &writeResult, &options, line, lineNumber, queued] {
+            static Histogram& decodeTime = MetricsRegistry::instance().histogram("decode_ms");
+            TraceSpan querySpan("query", "batch", newCorrelationId());
+            json response;
+            try {
+                json request = json::parse(line);
+                response["id"] = request.value("id", json(lineNumber));
+                std::string image = request.at("image").get<std::string>();
+                std::string galleryPath = request.value("gallery", options.defaultGallery);
+                size_t topK = request.value("top_k", options.topK);
+                float threshold = request.value("threshold", options.threshold);
+                response["image"] = image;
+                double queueMs = elapsedMs(queued);
+
+                const Gallery* target = gallery(galleryPath);
+                if (!target) {
+                    response["error"] = "cannot load gallery: " + galleryPath;
+                    writeResult(response, true);
+                    return;
+                }
+
+                auto decodeStart = Clock::now();
+                cv::Mat img;
+                {
+                    TraceSpan span("decode", "batch");
+                    img = cv::imread(image, cv::IMREAD_COLOR);
+                }
+                if (img.empty()) {
+                    response["error"] = "cannot read image: " + image;
+                    writeResult(response, true);
+                    return;
+                }
+                double decodeMs = elapsedMs(decodeStart);
+                decodeTime.record(decodeMs);
+
+                auto inferenceStart = Clock::now();
+                std::vector<float> embedding = extractor.getEmbedding(img);
+                double inferenceMs = elapsedMs(inferenceStart);
+
+                auto matchStart = Clock::now();
+                json matches = json::array();
+                {
+                    TraceSpan span("match", "batch");
+                    for (const auto& match : target->query(embedding, topK, threshold))
+                        matches.push_back({{"id", match.id}, {"score", match.score}});
+                }
+                double matchMs = elapsedMs(matchStart);
+
+                response["matches"] = std::move(matches);
+                response["timings_ms"] = {
+                    {"queue", queueMs},
+                    {"decode", decodeMs},
+                    {"inference", inferenceMs},
+                    {"match", matchMs},
+                    {"total", elapsedMs(queued)},
+                };
+                writeResult(response, false);
+            } catch (const std::exception& e) {
+                if (!response.contains("id"))
+                    response["id"] = lineNumber;
+                response["error"] = e.what();
+                writeResult(response, true);
+            }
+        });
+    }
+
+    std::unique_lock<std::mutex> lock(mutex);
+    slotFree.wait(lock, [&] { return inFlight == 0; });
+    results.flush();
+    return stats;
+}
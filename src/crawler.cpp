@@ -1,141 +1,154 @@
 #include "crawler.hpp"
 #include "face_embedder.hpp"
+#include "http_client.hpp"
+#include "metrics.hpp"
+#include "trace.hpp"
+#include "report_writer.hpp"
+#include "onnx_face_compare.hpp"
+#include "ort_runtime.hpp"
 #include <opencv2/opencv.hpp>
 #include <onnxruntime_cxx_api.h>
+#include <algorithm>
+#include <chrono>
 #include <cmath>
 #include <iostream>
 #include <curl/curl.h>
 #include <regex>
 #include <fstream>
-#include <nlohmann/json.hpp>
-#include <QDir>
 #include <QStandardPaths>
-#include <QPdfWriter>
-#include <QPainter>
-#include <QImage>
-
-using json = nlohmann::json;
 
 // Forward declarations
-std::vector<float> preprocessFace(const cv::Mat& img);
 std::vector<float> getEmbedding(const std::vector<float>& input);
-float cosineSimilarity(const std::vector<float>& a, const std::vector<float>& b);
 
 // Globals
 Crawler::Crawler(const std::string& path) : inputImagePath(path), stopFlag(false) {}
 
-Ort::Env env{ORT_LOGGING_LEVEL_WARNING, "faceNet"};
+Crawler::~Crawler() {
+    if (http && http != ownedHttp.get())
+        http->setCancelFlag(nullptr);
+}
+
 Ort::Session* session = nullptr;
-Ort::SessionOptions session_options;
 std::vector<float> referenceEmbedding;
 
-static size_t WriteCallback(void* contents, size_t size, size_t nmemb, std::string* output) {
-    size_t totalSize = size * nmemb;
-    output->append((char*)contents, totalSize);
-    return totalSize;
-}
-
 void Crawler::startSearch() {
     std::cout << "Starting web search.....\n";
+    TraceSpan span("search", "crawler", newCorrelationId());
 
-std::cout << "Trying to load ONNX model from: " << QDir::currentPath().toStdString() << "/models/faceNet.onnx" << std::endl;
-
-        try {
-            session_options.SetIntraOpNumThreads(1);
-            session_options.SetGraphOptimizationLevel(GraphOptimizationLevel::ORT_ENABLE_ALL);
-            session = new Ort::Session(env, "models/faceNet.onnx", session_options);
-        } catch (const Ort::Exception& e) {
-            std::cerr << "Failed to load ONNX model: " << e.what() << "\n";
-            return;
-        }
-
-    // Extract reference face embedding
-    cv::Mat refImg = cv::imread(inputImagePath);
-    if (refImg.empty()) {
-        std::cerr << "Failed to load reference image.\n";
+    if (!loadReference())
         return;
-    }
-
-    referenceEmbedding = getEmbedding(preprocessFace(refImg));
 
     crawlSurfaceWeb();
+    if (stopFlag) return;
     crawlDeepWeb();
+    if (stopFlag) return;
     crawlDarkWeb();
 }
 
+void Crawler::scanUrls(const std::vector<std::string>& urls, const std::string& source) {
+    TraceSpan span("search", "crawler", newCorrelationId());
+    if (!loadReference())
+        return;
+    checkCandidates(urls, source, static_cast<int>(urls.size()));
+}
+
+bool Crawler::loadReference() {
+    // The shared model stays loaded between searches
+    if (!preloadFaceEmbedder())
+        return false;
+
+    // Extract reference face embedding. Kept per crawler rather than in the
+    // global, which the GUI owns while a search runs in the background.
+    if (reference.empty()) {
+        cv::Mat refImg = cv::imread(inputImagePath);
+        if (refImg.empty()) {
+            std::cerr << "Failed to load reference image.\n";
+            return false;
+        }
+        reference = extractEmbeddingFromImage(refImg);
+    }
+    return !reference.empty();
+}
+
 void Crawler::stopSearch() {
     stopFlag = true;
 }
 
+bool Crawler::stopped() const {
+    return stopFlag;
+}
+
+void Crawler::setHttpClient(HttpClient* client) {
+    http = client;
+    if (http)
+        http->setCancelFlag(&stopFlag);
+}
+
+HttpClient& Crawler::client() {
+    if (!http) {
+        ownedHttp = std::make_unique<HttpClient>();
+        setHttpClient(ownedHttp.get());
+    }
+    return *http;
+}
+
 // Add getter method for matched images
-std::vector<std::pair<std::string, float>> Crawler::getMatchedImages() const {
+std::vector<MatchResult> Crawler::getMatchedImages() const {
     return matchedImages;
 }
 
+void Crawler::setMatchCallback(std::function<void(const MatchResult&)> callback) {
+    matchCallback = std::move(callback);
+}
+
+void Crawler::setReferenceEmbedding(std::vector<float> embedding) {
+    reference = std::move(embedding);
+}
+
+void Crawler::setThumbnailBudget(size_t bytes) {
+    thumbnailBudget = bytes;
+}
+
 void Crawler::downloadResults(const std::string& outPath) {
     if (matchedImages.empty()) {
         std::cout << "No results to save.\n";
         return;
     }
 
-    QString pdfPath = QString::fromStdString(outPath);
-    QPdfWriter writer(pdfPath);
-    writer.setPageSize(QPageSize(QPageSize::A4));
-    QPainter painter(&writer);
-
-    int y = 0;
-    for (const auto& [url, score] : matchedImages) {
-        CURL* curl = curl_easy_init();
-        std::string buffer;
-
-        curl_easy_setopt(curl, CURLOPT_URL, url.c_str());
-        curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, WriteCallback);
-        curl_easy_setopt(curl, CURLOPT_WRITEDATA, &buffer);
-        curl_easy_perform(curl);
-        curl_easy_cleanup(curl);
-
-        std::vector<uchar> data(buffer.begin(), buffer.end());
-        QImage image = QImage::fromData(QByteArray((const char*)data.data(), data.size()));
-
-        if (!image.isNull()) {
-            painter.drawImage(50, y + 30, image.scaledToWidth(300));
-            painter.drawText(50, y + image.height() + 40, QString("URL: %1").arg(QString::fromStdString(url)));
-            painter.drawText(50, y + image.height() + 60, QString("Similarity: %1").arg(score));
-            y += image.height() + 100;
-
-            if (y > 1000) {
-                writer.newPage();
-                y = 0;
-            }
+    bool missingThumbnails = std::any_of(matchedImages.begin(), matchedImages.end(),
+                                         [](const MatchResult& m) { return m.thumbnail.empty(); });
+    std::vector<MatchResult> refetched;
+    if (missingThumbnails) {
+        refetched = matchedImages;
+        for (auto& match : refetched) {
+            if (!match.thumbnail.empty()) continue;
+
+            // Thumbnail budget was exhausted for this match; fetch it again.
+            std::string buffer;
+            if (client().get(match.url, buffer))
+                match.thumbnail.assign(buffer.begin(), buffer.end());
         }
     }
 
-    painter.end();
+    if (!writeReport(missingThumbnails ? refetched : matchedImages, outPath, nullptr, kThumbnailWidth)) {
+        std::cerr << "Failed to write report: " << outPath << "\n";
+        return;
+    }
     std::cout << "✅ Results saved to: " << outPath << "\n";
 }
 
 void Crawler::crawlSurfaceWeb() {
     std::cout << "Scanning surface web using Yandex...\n";
 
-    CURL* curl = curl_easy_init();
-    if (!curl) {
-        std::cerr << "CURL init failed.\n";
-        return;
-    }
-
     std::ifstream file(inputImagePath, std::ios::binary);
     if (!file.is_open()) {
         std::cerr << "Failed to open image.\n";
-        curl_easy_cleanup(curl);
         return;
     }
 
     std::vector<char> imageData((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
 
     std::string response;
-    struct curl_slist* headers = nullptr;
-    headers = curl_slist_append(headers, "Content-Type: multipart/form-data");
-
     std::string boundary = "----WebKitFormBoundary7MA4YWxkTrZu0gW";
     std::ostringstream postFields;
     postFields << "--" << boundary << "\r\n"
@@ -146,22 +159,13 @@ void Crawler::crawlSurfaceWeb() {
 
     std::string postData = postFields.str();
 
-    curl_easy_setopt(curl, CURLOPT_URL, "https://yandex.com/images/search");
-    curl_easy_setopt(curl, CURLOPT_POST, 1L);
-    curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headers);
-    curl_easy_setopt(curl, CURLOPT_POSTFIELDS, postData.c_str());
-    curl_easy_setopt(curl, CURLOPT_POSTFIELDSIZE, postData.size());
-    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, WriteCallback);
-    curl_easy_setopt(curl, CURLOPT_WRITEDATA, &response);
-    curl_easy_setopt(curl, CURLOPT_FOLLOWLOCATION, 1L);
-    curl_easy_setopt(curl, CURLOPT_USERAGENT, "Mozilla/5.0");
-
-    CURLcode res = curl_easy_perform(curl);
-    curl_easy_cleanup(curl);
-
-    if (res != CURLE_OK) {
-        std::cerr << "Yandex upload failed: " << curl_easy_strerror(res) << "\n";
-        return;
+    {
+        TraceSpan span("upload", "crawler");
+        if (!client().post("https://yandex.com/images/search", postData,
+                           {"Content-Type: multipart/form-data"}, response)) {
+            std::cerr << "Yandex upload failed: " << client().lastError() << "\n";
+            return;
+        }
     }
 
     std::smatch match;
@@ -174,51 +178,54 @@ void Crawler::crawlSurfaceWeb() {
     std::string redirectUrl = std::regex_replace(match[0].str(), std::regex(R"(\\/)"), "/");
     std::string fullUrl = "https://yandex.com" + redirectUrl;
 
-    CURL* curl2 = curl_easy_init();
-    if (!curl2) {
-        std::cerr << "Failed to init second curl.\n";
-        return;
-    }
-
+    // Same handle, so the connection to yandex.com is reused
     std::string html;
-    curl_easy_setopt(curl2, CURLOPT_URL, fullUrl.c_str());
-    curl_easy_setopt(curl2, CURLOPT_WRITEFUNCTION, WriteCallback);
-    curl_easy_setopt(curl2, CURLOPT_WRITEDATA, &html);
-    curl_easy_setopt(curl2, CURLOPT_USERAGENT, "Mozilla/5.0");
-    curl_easy_setopt(curl2, CURLOPT_FOLLOWLOCATION, 1L);
-    res = curl_easy_perform(curl2);
-    curl_easy_cleanup(curl2);
-
-    if (res != CURLE_OK) {
-        std::cerr << "Failed to fetch Yandex results page.\n";
-        return;
+    {
+        TraceSpan span("results_page", "crawler");
+        if (!client().get(fullUrl, html)) {
+            std::cerr << "Failed to fetch Yandex results page.\n";
+            return;
+        }
     }
 
-    std::regex imgRegex(R"(img_url=([^&]+))");
-    auto begin = std::sregex_iterator(html.begin(), html.end(), imgRegex);
-    auto end = std::sregex_iterator();
-
-    int matches = 0;
-    for (auto i = begin; i != end && matches < 10; ++i) {
-        std::string encodedUrl = (*i)[1];
-        std::string imageUrl;
+    checkCandidates(findImageUrls(html), "yandex", 10);
+}
 
-        char* decoded = curl_unescape(encodedUrl.c_str(), encodedUrl.length());
-        imageUrl = decoded;
-        curl_free(decoded);
+void Crawler::checkCandidates(const std::vector<std::string>& urls, const std::string& source, int maxMatches) {
+    using Clock = std::chrono::steady_clock;
+    static Histogram& imageTime = MetricsRegistry::instance().histogram("image_ms");
 
+    int matches = 0;
+    for (const std::string& imageUrl : urls) {
+        if (matches >= maxMatches || stopFlag)
+            break;
         std::cout << "Checking image: " << imageUrl << "\n";
-        if (imageMatches(imageUrl)) {
+        auto start = Clock::now();
+        bool matched = imageMatches(imageUrl, source);
+        imageTime.record(std::chrono::duration<double, std::milli>(Clock::now() - start).count());
+        if (matched) {
             std::cout << "✅ Match found: " << imageUrl << "\n";
             ++matches;
         }
     }
 
     if (matches == 0) {
-        std::cout << "No matching images found on Yandex.\n";
+        std::cout << "No matching images found on " << source << ".\n";
     }
 }
 
+std::vector<std::string> findImageUrls(const std::string& html) {
+    static const std::regex imgRegex(R"(img_url=([^&]+))");
+    std::vector<std::string> urls;
+    for (auto i = std::sregex_iterator(html.begin(), html.end(), imgRegex); i != std::sregex_iterator(); ++i) {
+        std::string encodedUrl = (*i)[1];
+        char* decoded = curl_unescape(encodedUrl.c_str(), static_cast<int>(encodedUrl.length()));
+        urls.emplace_back(decoded);
+        curl_free(decoded);
+    }
+    return urls;
+}
+
 void Crawler::crawlDeepWeb() {
     std::cout << "Scanning deep web for your image...\n";
 }
@@ -227,35 +234,94 @@ void Crawler::crawlDarkWeb() {
     std::cout << "Scanning dark web for your image...\n";
 }
 
-bool Crawler::imageMatches(const std::string& url) {
-    CURL* curl = curl_easy_init();
-    if (!curl) return false;
-
+bool Crawler::imageMatches(const std::string& url, const std::string& source) {
+    using Clock = std::chrono::steady_clock;
+    auto elapsedMs = [](Clock::time_point since) {
+        return std::chrono::duration<double, std::milli>(Clock::now() - since).count();
+    };
+    static Histogram& downloadTime = MetricsRegistry::instance().histogram("download_ms");
+    static Histogram& decodeTime = MetricsRegistry::instance().histogram("decode_ms");
+    static Histogram& matchTime = MetricsRegistry::instance().histogram("match_ms");
+    static Counter& matchCount = MetricsRegistry::instance().counter("matches");
+    // Every stage of this candidate carries the image's correlation id
+    TraceSpan imageSpan("image", "crawler", newCorrelationId());
+
+    auto downloadStart = Clock::now();
     std::string buffer;
-    curl_easy_setopt(curl, CURLOPT_URL, url.c_str());
-    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, WriteCallback);
-    curl_easy_setopt(curl, CURLOPT_WRITEDATA, &buffer);
-    CURLcode res = curl_easy_perform(curl);
-    curl_easy_cleanup(curl);
-    if (res != CURLE_OK) return false;
-
-    std::vector<uchar> data(buffer.begin(), buffer.end());
-    cv::Mat img = cv::imdecode(data, cv::IMREAD_COLOR);
+    {
+        TraceSpan span("download", "crawler");
+        if (!client().get(url, buffer)) return false;
+    }
+    double downloadMs = elapsedMs(downloadStart);
+    downloadTime.record(downloadMs);
+
+    auto decodeStart = Clock::now();
+    cv::Mat img;
+    {
+        TraceSpan span("decode", "crawler");
+        std::vector<uchar> data(buffer.begin(), buffer.end());
+        img = cv::imdecode(data, cv::IMREAD_COLOR);
+    }
     if (img.empty()) return false;
+    double decodeMs = elapsedMs(decodeStart);
+    decodeTime.record(decodeMs);
+
+    auto inferenceStart = Clock::now();
+    auto embedding = extractEmbeddingFromImage(img);
+    if (embedding.empty()) return false;
+    double inferenceMs = elapsedMs(inferenceStart);
 
-    auto input = preprocessFace(img);
-    auto embedding = getEmbedding(input);
-    float similarity = cosineSimilarity(referenceEmbedding, embedding);
+    auto matchStart = Clock::now();
+    float similarity = cosineSimilarity(reference, embedding);
+    matchTime.record(elapsedMs(matchStart));
 
     std::cout << "Similarity score with " << url << ": " << similarity << "\n";
     
     if (similarity > 0.75f) {
-        matchedImages.emplace_back(url, similarity);  // ✅ Save for PDF
+        matchCount.add();
+        MatchResult result;
+        result.url = url;
+        result.similarity = similarity;
+        result.source = source;
+        result.boxWidth = img.cols;
+        result.boxHeight = img.rows;
+        result.downloadMs = downloadMs;
+        result.decodeMs = decodeMs;
+        result.inferenceMs = inferenceMs;
+        result.thumbnail = makeThumbnail(img, buffer);  // ✅ Save for PDF
+        if (matchCallback)
+            matchCallback(result);
+        matchedImages.push_back(std::move(result));
         return true;
     }
     return false;
 }
 
+std::vector<unsigned char> Crawler::makeThumbnail(const cv::Mat& img, const std::string& encoded) {
+    std::vector<unsigned char> thumb;
+
+    // Small JPEGs are kept as downloaded, everything else is re-encoded at report width.
+    bool isJpeg = encoded.size() > 2 &&
+                  static_cast<unsigned char>(encoded[0]) == 0xFF &&
+                  static_cast<unsigned char>(encoded[1]) == 0xD8;
+    if (isJpeg && img.cols <= kThumbnailWidth) {
+        thumb.assign(encoded.begin(), encoded.end());
+    } else {
+        cv::Mat scaled = img;
+        if (img.cols > kThumbnailWidth) {
+            int height = std::max(1, img.rows * kThumbnailWidth / img.cols);
+            cv::resize(img, scaled, cv::Size(kThumbnailWidth, height), 0, 0, cv::INTER_AREA);
+        }
+        cv::imencode(".jpg", scaled, thumb, {cv::IMWRITE_JPEG_QUALITY, 85});
+    }
+
+    if (thumbnailBytes + thumb.size() > thumbnailBudget) {
+        return {};
+    }
+    thumbnailBytes += thumb.size();
+    return thumb;
+}
+
 std::vector<float> preprocessFace(const cv::Mat& img) {
     cv::Mat resized;
     cv::resize(img, resized, cv::Size(160, 160));
@@ -275,6 +341,11 @@ std::vector<float> preprocessFace(const cv::Mat& img) {
 }
 
 std::vector<float> getEmbedding(const std::vector<float>& input) {
+    // Crawler searches use the shared extractor; this session is only
+    // created for callers of the raw-tensor path
+    if (!session) {
+        session = new Ort::Session(OrtRuntime::instance().createSession(kDefaultModelPath, SessionSettings{}));
+    }
     Ort::AllocatorWithDefaultOptions allocator;
 
     const int64_t dims[] = {1, 160, 160, 3};
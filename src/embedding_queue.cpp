@@ -0,0 +1,114 @@
+#include "embedding_queue.hpp"
+#include "metrics.hpp"
+#include "trace.hpp"
+#include <algorithm>
+#include <stdexcept>
+
+EmbeddingQueue::EmbeddingQueue(FaceEmbeddingExtractor& extractor, EmbeddingQueueOptions options)
+    : extractor(extractor), options(options), depth(MetricsRegistry::instance().gauge("embedding_queue_depth")) {
+    if (this->options.maxBatch == 0)
+        this->options.maxBatch = 1;
+    size_t count = std::max<size_t>(1, this->options.workers);
+    for (size_t i = 0; i < count; ++i)
+        workers.emplace_back([this] { workerLoop(); });
+}
+
+EmbeddingQueue::~EmbeddingQueue() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    ready.notify_all();
+    for (std::thread& worker : workers)
+        worker.join();
+}
+
+int EmbeddingQueue::addStream(unsigned priority) {
+    std::lock_guard<std::mutex> lock(mutex);
+    lanes.emplace_back();
+    lanes.back().priority = std::max(1u, priority);
+    return static_cast<int>(lanes.size() - 1);
+}
+
+std::future<std::vector<float>> EmbeddingQueue::submit(int stream, cv::Mat face) {
+    Request request;
+    request.face = std::move(face);
+    std::future<std::vector<float>> result = request.result.get_future();
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (stopping || stream < 0 || static_cast<size_t>(stream) >= lanes.size()) {
+            request.result.set_exception(std::make_exception_ptr(std::runtime_error("embedding queue unavailable")));
+            return result;
+        }
+        lanes[stream].pending.push_back(std::move(request));
+        ++pendingTotal;
+        depth.add(1);
+    }
+    ready.notify_one();
+    return result;
+}
+
+uint64_t EmbeddingQueue::batches() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return batchCount;
+}
+
+uint64_t EmbeddingQueue::embedded() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return embeddingCount;
+}
+
+// Called with the mutex held and at least one request pending
+std::vector<EmbeddingQueue::Request> EmbeddingQueue::takeBatch() {
+    std::vector<Request> batch;
+    while (batch.size() < options.maxBatch && pendingTotal > 0) {
+        Lane& lane = lanes[cursor];
+        size_t take = std::min<size_t>({lane.priority, lane.pending.size(), options.maxBatch - batch.size()});
+        for (size_t i = 0; i < take; ++i) {
+            batch.push_back(std::move(lane.pending.front()));
+            lane.pending.pop_front();
+        }
+        pendingTotal -= take;
+        depth.add(-static_cast<int64_t>(take));
+        cursor = (cursor + 1) % lanes.size();
+    }
+    return batch;
+}
+
+void EmbeddingQueue::workerLoop() {
+    Tracer::instance().nameThread("embedding queue");
+    std::unique_lock<std::mutex> lock(mutex);
+    for (;;) {
+        ready.wait(lock, [this] { return stopping || pendingTotal > 0; });
+        if (pendingTotal == 0)
+            return;
+
+        // Give other streams a moment to add to a partial batch
+        if (!stopping && pendingTotal < options.maxBatch && options.maxWait.count() > 0)
+            ready.wait_for(lock, options.maxWait, [this] { return stopping || pendingTotal >= options.maxBatch; });
+        if (pendingTotal == 0)
+            continue;
+
+        std::vector<Request> batch = takeBatch();
+        ++batchCount;
+        embeddingCount += batch.size();
+        lock.unlock();
+
+        std::vector<cv::Mat> faces;
+        faces.reserve(batch.size());
+        for (const Request& request : batch)
+            faces.push_back(request.face);
+        try {
+            TraceSpan span("batch", "queue");
+            span.setItems(static_cast<int64_t>(faces.size()));
+            std::vector<std::vector<float>> embeddings = extractor.getEmbeddings(faces);
+            for (size_t i = 0; i < batch.size(); ++i)
+                batch[i].result.set_value(std::move(embeddings[i]));
+        } catch (...) {
+            for (Request& request : batch)
+                request.result.set_exception(std::current_exception());
+        }
+
+        lock.lock();
+    }
+}
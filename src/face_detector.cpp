@@ -0,0 +1,46 @@
+#include "face_detector.hpp"
+#include <opencv2/imgproc.hpp>
+#include <algorithm>
+#include <iostream>
+
+FaceDetector::FaceDetector(const std::string& cascadePath) {
+    if (!cascadePath.empty() && !cascade.load(cascadePath))
+        std::cerr << "Face cascade not found at " << cascadePath << ", treating whole frames as faces\n";
+}
+
+std::vector<cv::Rect> FaceDetector::detect(const cv::Mat& frame) {
+    if (frame.empty())
+        return {};
+    if (cascade.empty())
+        return {cv::Rect(0, 0, frame.cols, frame.rows)};
+
+    cv::cvtColor(frame, gray, frame.channels() == 4 ? cv::COLOR_BGRA2GRAY : cv::COLOR_BGR2GRAY);
+
+    double scale = 1.0;
+    cv::Mat* input = &gray;
+    if (maxWidth > 0 && gray.cols > maxWidth) {
+        scale = static_cast<double>(gray.cols) / maxWidth;
+        cv::resize(gray, small, cv::Size(maxWidth, cvRound(gray.rows / scale)), 0, 0, cv::INTER_AREA);
+        input = &small;
+    }
+    cv::equalizeHist(*input, *input);
+
+    int minSize = std::max(1, cvRound(minFaceSize / scale));
+    std::vector<cv::Rect> faces;
+    cascade.detectMultiScale(*input, faces, 1.1, 5, 0, cv::Size(minSize, minSize));
+
+    if (scale != 1.0) {
+        for (cv::Rect& face : faces) {
+            face = cv::Rect(cvRound(face.x * scale), cvRound(face.y * scale),
+                            cvRound(face.width * scale), cvRound(face.height * scale));
+        }
+    }
+    return faces;
+}
+
+cv::Rect FaceDetector::expand(const cv::Rect& face, const cv::Size& frame, double margin) {
+    int dx = cvRound(face.width * margin);
+    int dy = cvRound(face.height * margin);
+    cv::Rect grown(face.x - dx, face.y - dy, face.width + 2 * dx, face.height + 2 * dy);
+    return grown & cv::Rect(0, 0, frame.width, frame.height);
+}
@@ -0,0 +1,87 @@
+#include "face_quality.hpp"
+#include <opencv2/imgproc.hpp>
+#include <algorithm>
+
+namespace {
+
+constexpr int kAnalysisSize = 64;
+
+}  // namespace
+
+const char* FaceQuality::name(Verdict verdict) {
+    switch (verdict) {
+    case Accepted: return "accepted";
+    case TooSmall: return "too small";
+    case Blurry: return "blurry";
+    case TooDark: return "too dark";
+    case TooBright: return "too bright";
+    case Turned: return "turned";
+    default: return "unknown";
+    }
+}
+
+FaceQualityScorer::FaceQualityScorer(QualityThresholds thresholds) : limits(thresholds) {}
+
+FaceQuality FaceQualityScorer::assess(const cv::Mat& face) const {
+    FaceQuality quality;
+    ++assessedCount;
+    if (face.empty()) {
+        quality.verdict = FaceQuality::TooSmall;
+        ++counts[quality.verdict];
+        return quality;
+    }
+    quality.size = std::min(face.cols, face.rows);
+
+    cv::Mat small;
+    cv::Mat gray;
+    cv::resize(face, small, cv::Size(kAnalysisSize, kAnalysisSize), 0, 0, cv::INTER_AREA);
+    if (small.channels() == 1)
+        gray = small;
+    else
+        cv::cvtColor(small, gray, small.channels() == 4 ? cv::COLOR_BGRA2GRAY : cv::COLOR_BGR2GRAY);
+
+    cv::Mat laplacian;
+    cv::Scalar mean;
+    cv::Scalar stddev;
+    cv::Laplacian(gray, laplacian, CV_16S);
+    cv::meanStdDev(laplacian, mean, stddev);
+    quality.sharpness = static_cast<float>(stddev[0] * stddev[0]);
+    quality.brightness = static_cast<float>(cv::mean(gray)[0]);
+
+    // Correlate the left half with the mirrored right half
+    const int half = kAnalysisSize / 2;
+    cv::Mat mirrored;
+    cv::flip(gray(cv::Rect(half, 0, half, kAnalysisSize)), mirrored, 1);
+    cv::Mat correlation;
+    cv::matchTemplate(gray(cv::Rect(0, 0, half, kAnalysisSize)), mirrored, correlation, cv::TM_CCOEFF_NORMED);
+    quality.symmetry = std::max(0.0f, correlation.at<float>(0, 0));
+
+    if (quality.size < limits.minFaceSize)
+        quality.verdict = FaceQuality::TooSmall;
+    else if (quality.brightness < limits.minBrightness)
+        quality.verdict = FaceQuality::TooDark;
+    else if (quality.brightness > limits.maxBrightness)
+        quality.verdict = FaceQuality::TooBright;
+    else if (quality.sharpness < limits.minSharpness)
+        quality.verdict = FaceQuality::Blurry;
+    else if (quality.symmetry < limits.minSymmetry)
+        quality.verdict = FaceQuality::Turned;
+
+    // Each factor saturates at twice its threshold
+    auto factor = [](float value, float threshold) {
+        return threshold > 0.0f ? std::min(1.0f, value / (2.0f * threshold)) : 1.0f;
+    };
+    quality.score = factor(static_cast<float>(quality.size), static_cast<float>(limits.minFaceSize)) *
+                    factor(quality.sharpness, limits.minSharpness) *
+                    std::min(1.0f, quality.symmetry);
+
+    ++counts[quality.verdict];
+    return quality;
+}
+
+uint64_t FaceQualityScorer::rejected() const {
+    uint64_t total = 0;
+    for (int v = FaceQuality::Accepted + 1; v < FaceQuality::VerdictCount; ++v)
+        total += counts[v];
+    return total;
+}
@@ -0,0 +1,166 @@
+#include "face_tracker.hpp"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+// State: centre x, centre y, width, height and their velocities
+constexpr int kState = 8;
+constexpr int kMeasured = 4;
+
+cv::Mat measurementFor(const cv::Rect& box) {
+    cv::Mat m(kMeasured, 1, CV_32F);
+    m.at<float>(0) = box.x + box.width * 0.5f;
+    m.at<float>(1) = box.y + box.height * 0.5f;
+    m.at<float>(2) = static_cast<float>(box.width);
+    m.at<float>(3) = static_cast<float>(box.height);
+    return m;
+}
+
+cv::Rect boxFor(const cv::Mat& state) {
+    float w = std::max(1.0f, state.at<float>(2));
+    float h = std::max(1.0f, state.at<float>(3));
+    return cv::Rect(cvRound(state.at<float>(0) - w * 0.5f), cvRound(state.at<float>(1) - h * 0.5f),
+                    cvRound(w), cvRound(h));
+}
+
+}  // namespace
+
+FaceTracker::FaceTracker(TrackerOptions options) : options(options) {}
+
+float FaceTracker::iou(const cv::Rect& a, const cv::Rect& b) {
+    int overlap = (a & b).area();
+    int combined = a.area() + b.area() - overlap;
+    return combined > 0 ? static_cast<float>(overlap) / combined : 0.0f;
+}
+
+Track FaceTracker::makeTrack(const cv::Rect& box) {
+    Track track;
+    track.id = nextId++;
+    track.box = box;
+    track.hits = 1;
+
+    cv::KalmanFilter& kf = track.filter;
+    kf.init(kState, kMeasured, 0, CV_32F);
+    cv::setIdentity(kf.transitionMatrix);
+    for (int i = 0; i < kMeasured; ++i)
+        kf.transitionMatrix.at<float>(i, i + kMeasured) = 1.0f;
+    kf.measurementMatrix = cv::Mat::zeros(kMeasured, kState, CV_32F);
+    for (int i = 0; i < kMeasured; ++i)
+        kf.measurementMatrix.at<float>(i, i) = 1.0f;
+
+    // Positions are trusted far more than the (unknown) initial velocities
+    cv::setIdentity(kf.processNoiseCov, cv::Scalar::all(1.0));
+    for (int i = kMeasured; i < kState; ++i)
+        kf.processNoiseCov.at<float>(i, i) = 0.01f;
+    cv::setIdentity(kf.measurementNoiseCov, cv::Scalar::all(10.0));
+    cv::setIdentity(kf.errorCovPost, cv::Scalar::all(10.0));
+    for (int i = kMeasured; i < kState; ++i)
+        kf.errorCovPost.at<float>(i, i) = 1000.0f;
+
+    kf.statePost = cv::Mat::zeros(kState, 1, CV_32F);
+    measurementFor(box).copyTo(kf.statePost.rowRange(0, kMeasured));
+    return track;
+}
+
+std::vector<int> FaceTracker::update(const std::vector<cv::Rect>& detections) {
+    ++frame;
+
+    std::vector<cv::Rect> predicted(active.size());
+    for (size_t t = 0; t < active.size(); ++t)
+        predicted[t] = boxFor(active[t].filter.predict());
+
+    // Greedy assignment, best overlap first; faces rarely overlap each
+    // other, so this matches an optimal assignment in practice
+    struct Pair {
+        float iou;
+        size_t track;
+        size_t detection;
+    };
+    std::vector<Pair> pairs;
+    for (size_t t = 0; t < active.size(); ++t) {
+        for (size_t d = 0; d < detections.size(); ++d) {
+            float overlap = iou(predicted[t], detections[d]);
+            if (overlap >= options.iouThreshold)
+                pairs.push_back({overlap, t, d});
+        }
+    }
+    std::sort(pairs.begin(), pairs.end(), [](const Pair& a, const Pair& b) { return a.iou > b.iou; });
+
+    std::vector<int> assigned(detections.size(), 0);
+    std::vector<bool> trackTaken(active.size(), false);
+    for (const Pair& pair : pairs) {
+        if (trackTaken[pair.track] || assigned[pair.detection])
+            continue;
+        trackTaken[pair.track] = true;
+        Track& track = active[pair.track];
+        track.filter.correct(measurementFor(detections[pair.detection]));
+        track.box = detections[pair.detection];
+        ++track.hits;
+        track.misses = 0;
+        assigned[pair.detection] = track.id;
+    }
+
+    for (size_t t = 0; t < active.size(); ++t) {
+        if (!trackTaken[t]) {
+            active[t].box = predicted[t];
+            ++active[t].misses;
+        }
+    }
+    active.erase(std::remove_if(active.begin(), active.end(),
+                                [this](const Track& track) { return track.misses > options.maxMisses; }),
+                 active.end());
+
+    for (size_t d = 0; d < detections.size(); ++d) {
+        if (!assigned[d]) {
+            active.push_back(makeTrack(detections[d]));
+            assigned[d] = active.back().id;
+        }
+    }
+    return assigned;
+}
+
+bool FaceTracker::wantsEmbedding(int trackId, float quality) const {
+    auto it = std::find_if(active.begin(), active.end(), [trackId](const Track& t) { return t.id == trackId; });
+    if (it == active.end())
+        return false;
+    if (it->samples == 0)
+        return true;
+    if (frame - it->lastEmbedFrame >= static_cast<uint64_t>(options.reembedInterval))
+        return true;
+    return quality > it->bestQuality * options.qualityGain;
+}
+
+void FaceTracker::addEmbedding(int trackId, const std::vector<float>& embedding, float quality) {
+    Track* track = find(trackId);
+    if (!track || embedding.empty())
+        return;
+    if (track->sum.size() != embedding.size()) {
+        track->sum.assign(embedding.size(), 0.0f);
+        track->samples = 0;
+    }
+
+    for (size_t i = 0; i < embedding.size(); ++i)
+        track->sum[i] += embedding[i];
+    ++track->samples;
+    track->lastEmbedFrame = frame;
+    track->bestQuality = std::max(track->bestQuality, quality);
+
+    float norm = 0.0f;
+    for (float v : track->sum)
+        norm += v * v;
+    norm = std::sqrt(norm);
+    track->embedding.resize(track->sum.size());
+    for (size_t i = 0; i < track->sum.size(); ++i)
+        track->embedding[i] = norm > 0.0f ? track->sum[i] / norm : 0.0f;
+}
+
+Track* FaceTracker::find(int trackId) {
+    auto it = std::find_if(active.begin(), active.end(), [trackId](const Track& t) { return t.id == trackId; });
+    return it == active.end() ? nullptr : &*it;
+}
+
+void FaceTracker::reset() {
+    active.clear();
+    frame = 0;
+}
@@ -0,0 +1,307 @@
+#include "gallery.hpp"
+#include "metrics.hpp"
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <queue>
+
+namespace {
+
+struct GalleryHeader {
+    char magic[4];
+    uint32_t version;
+    uint32_t dim;
+    uint32_t reserved;
+    uint64_t count;
+    uint64_t idsOffset;
+};
+static_assert(sizeof(GalleryHeader) <= Gallery::kHeaderSize, "gallery header too large");
+
+struct WorseMatch {
+    bool operator()(const GalleryMatch& a, const GalleryMatch& b) const { return a.score > b.score; }
+};
+
+bool validHeader(const GalleryHeader& header) {
+    return std::memcmp(header.magic, "FRGL", 4) == 0 && header.version == Gallery::kVersion;
+}
+
+// Whether the sections the header describes fit in a file of `size` bytes.
+// Checked before anything is sized from the header, so a corrupt count or
+// dim can neither overflow the arithmetic nor ask for a huge allocation.
+bool fitsIn(const GalleryHeader& header, uint64_t size) {
+    if (size < Gallery::kHeaderSize)
+        return false;
+    uint64_t rowBytes = uint64_t(header.dim) * sizeof(float);
+    if (rowBytes != 0 && header.count > (size - Gallery::kHeaderSize) / rowBytes)
+        return false;
+    uint64_t embeddingsEnd = Gallery::kHeaderSize + header.count * rowBytes;
+    // Every id takes at least its 4-byte length
+    return header.idsOffset >= embeddingsEnd && header.idsOffset <= size &&
+           header.count <= (size - header.idsOffset) / sizeof(uint32_t);
+}
+
+}  // namespace
+
+Gallery::Gallery(size_t dim) : dimension(dim) {}
+
+Gallery::~Gallery() {
+    unmap();
+}
+
+Gallery::Gallery(Gallery&& other) noexcept {
+    *this = std::move(other);
+}
+
+Gallery& Gallery::operator=(Gallery&& other) noexcept {
+    if (this != &other) {
+        unmap();
+        dimension = other.dimension;
+        ids = std::move(other.ids);
+        ownedIds = std::move(other.ownedIds);
+        ownedEmbeddings = std::move(other.ownedEmbeddings);
+        data = other.data;
+        mapping = other.mapping;
+        mappingSize = other.mappingSize;
+        other.data = nullptr;
+        other.mapping = nullptr;
+        other.mappingSize = 0;
+        other.ids.clear();
+    }
+    return *this;
+}
+
+void Gallery::unmap() {
+    if (mapping) {
+        ::munmap(mapping, mappingSize);
+        mapping = nullptr;
+        mappingSize = 0;
+    }
+}
+
+void Gallery::makePrivate() {
+    if (!mapping)
+        return;
+    ownedEmbeddings.assign(data, data + ids.size() * dimension);
+    ownedIds.assign(ids.begin(), ids.end());
+    ids.assign(ownedIds.begin(), ownedIds.end());
+    data = ownedEmbeddings.data();
+    unmap();
+}
+
+bool Gallery::add(const std::string& id, const std::vector<float>& embedding) {
+    if (dimension == 0)
+        dimension = embedding.size();
+    if (embedding.empty() || embedding.size() != dimension)
+        return false;
+    makePrivate();
+    ownedIds.push_back(id);
+    ids.push_back(ownedIds.back());
+    ownedEmbeddings.insert(ownedEmbeddings.end(), embedding.begin(), embedding.end());
+    data = ownedEmbeddings.data();
+    return true;
+}
+
+std::vector<GalleryMatch> Gallery::query(const std::vector<float>& embedding, size_t topK, float threshold) const {
+    std::vector<GalleryMatch> results;
+    if (embedding.size() != dimension || topK == 0)
+        return results;
+
+    static Histogram& matchTime = MetricsRegistry::instance().histogram("match_ms");
+    auto start = std::chrono::steady_clock::now();
+
+    // Min-heap of the best topK scores seen so far
+    std::priority_queue<GalleryMatch, std::vector<GalleryMatch>, WorseMatch> best;
+    const float* query = embedding.data();
+    for (size_t i = 0; i < ids.size(); ++i) {
+        const float* row = data + i * dimension;
+        float score = 0.0f;
+        for (size_t d = 0; d < dimension; ++d)
+            score += query[d] * row[d];
+        if (score < threshold)
+            continue;
+        if (best.size() < topK) {
+            best.push({std::string(ids[i]), score});
+        } else if (score > best.top().score) {
+            best.pop();
+            best.push({std::string(ids[i]), score});
+        }
+    }
+
+    results.resize(best.size());
+    for (size_t i = results.size(); i-- > 0;) {
+        results[i] = best.top();
+        best.pop();
+    }
+    matchTime.record(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+    return results;
+}
+
+size_t Gallery::shardFor(std::string_view id, size_t shards) {
+    uint64_t hash = 14695981039346656037ull;
+    for (unsigned char c : id) {
+        hash ^= c;
+        hash *= 1099511628211ull;
+    }
+    return shards ? static_cast<size_t>(hash % shards) : 0;
+}
+
+std::vector<Gallery> Gallery::partition(size_t shards) const {
+    std::vector<Gallery> parts;
+    for (size_t i = 0; i < shards; ++i)
+        parts.emplace_back(dimension);
+    for (size_t i = 0; i < ids.size(); ++i) {
+        std::vector<float> row(embedding(i), embedding(i) + dimension);
+        parts[shardFor(ids[i], shards)].add(std::string(ids[i]), row);
+    }
+    return parts;
+}
+
+bool Gallery::save(const std::string& path) const {
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    if (!out.is_open()) {
+        std::cerr << "Failed to open gallery for writing: " << path << "\n";
+        return false;
+    }
+
+    GalleryHeader header{};
+    std::memcpy(header.magic, "FRGL", 4);
+    header.version = kVersion;
+    header.dim = static_cast<uint32_t>(dimension);
+    header.count = ids.size();
+    header.idsOffset = kHeaderSize + ids.size() * dimension * sizeof(float);
+
+    char padded[kHeaderSize] = {};
+    std::memcpy(padded, &header, sizeof(header));
+    out.write(padded, sizeof(padded));
+    out.write(reinterpret_cast<const char*>(data), ids.size() * dimension * sizeof(float));
+    for (const auto& id : ids) {
+        uint32_t length = static_cast<uint32_t>(id.size());
+        out.write(reinterpret_cast<const char*>(&length), sizeof(length));
+        out.write(id.data(), length);
+    }
+    return out.good();
+}
+
+bool Gallery::load(const std::string& path) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in.is_open()) {
+        std::cerr << "Failed to open gallery: " << path << "\n";
+        return false;
+    }
+
+    in.seekg(0, std::ios::end);
+    std::streamoff end = in.tellg();
+    in.seekg(0, std::ios::beg);
+
+    char padded[kHeaderSize];
+    GalleryHeader header;
+    if (end < 0 || !in.read(padded, sizeof(padded))) {
+        std::cerr << "Truncated gallery: " << path << "\n";
+        return false;
+    }
+    uint64_t fileSize = static_cast<uint64_t>(end);
+    std::memcpy(&header, padded, sizeof(header));
+    if (!validHeader(header) || !fitsIn(header, fileSize)) {
+        std::cerr << "Not a gallery file: " << path << "\n";
+        return false;
+    }
+
+    std::vector<float> loadedEmbeddings(header.count * header.dim);
+    std::deque<std::string> loadedIds(header.count);
+    in.read(reinterpret_cast<char*>(loadedEmbeddings.data()), loadedEmbeddings.size() * sizeof(float));
+    in.seekg(static_cast<std::streamoff>(header.idsOffset));
+    uint64_t pos = header.idsOffset;
+    for (auto& id : loadedIds) {
+        uint32_t length = 0;
+        if (!in.read(reinterpret_cast<char*>(&length), sizeof(length)))
+            break;
+        pos += sizeof(length);
+        if (length > fileSize - pos) {
+            in.setstate(std::ios::failbit);
+            break;
+        }
+        id.resize(length);
+        in.read(&id[0], length);
+        pos += length;
+    }
+    if (!in) {
+        std::cerr << "Truncated gallery: " << path << "\n";
+        return false;
+    }
+
+    unmap();
+    dimension = header.dim;
+    ownedIds = std::move(loadedIds);
+    ownedEmbeddings = std::move(loadedEmbeddings);
+    ids.assign(ownedIds.begin(), ownedIds.end());
+    data = ownedEmbeddings.data();
+    return true;
+}
+
+bool Gallery::map(const std::string& path) {
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        std::cerr << "Failed to open gallery: " << path << "\n";
+        return false;
+    }
+    struct stat st;
+    if (::fstat(fd, &st) < 0 || static_cast<size_t>(st.st_size) < kHeaderSize) {
+        ::close(fd);
+        std::cerr << "Truncated gallery: " << path << "\n";
+        return false;
+    }
+    size_t fileSize = static_cast<size_t>(st.st_size);
+    void* mapped = ::mmap(nullptr, fileSize, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (mapped == MAP_FAILED) {
+        std::cerr << "Failed to map gallery: " << path << "\n";
+        return false;
+    }
+
+    const char* bytes = static_cast<const char*>(mapped);
+    GalleryHeader header;
+    std::memcpy(&header, bytes, sizeof(header));
+    if (!validHeader(header) || !fitsIn(header, fileSize)) {
+        ::munmap(mapped, fileSize);
+        std::cerr << "Not a gallery file: " << path << "\n";
+        return false;
+    }
+
+    // Ids stay in the mapping; only the views are private
+    std::vector<std::string_view> mappedIds;
+    mappedIds.reserve(header.count);
+    size_t pos = header.idsOffset;
+    for (uint64_t i = 0; i < header.count; ++i) {
+        uint32_t length = 0;
+        if (sizeof(length) > fileSize - pos)
+            break;
+        std::memcpy(&length, bytes + pos, sizeof(length));
+        pos += sizeof(length);
+        if (length > fileSize - pos)
+            break;
+        mappedIds.emplace_back(bytes + pos, length);
+        pos += length;
+    }
+    if (mappedIds.size() != header.count) {
+        ::munmap(mapped, fileSize);
+        std::cerr << "Truncated gallery: " << path << "\n";
+        return false;
+    }
+
+    unmap();
+    ::madvise(mapped, fileSize, MADV_WILLNEED);
+    mapping = mapped;
+    mappingSize = fileSize;
+    dimension = header.dim;
+    ids = std::move(mappedIds);
+    ownedIds.clear();
+    ownedEmbeddings.clear();
+    data = reinterpret_cast<const float*>(bytes + kHeaderSize);
+    return true;
+}
@@ -0,0 +1,108 @@
+#include "http_client.hpp"
+#include "metrics.hpp"
+#include <curl/curl.h>
+#include <mutex>
+
+namespace {
+
+size_t appendBody(void* contents, size_t size, size_t nmemb, std::string* output) {
+    size_t totalSize = size * nmemb;
+    output->append(static_cast<char*>(contents), totalSize);
+    return totalSize;
+}
+
+int checkCancelled(void* flag, curl_off_t, curl_off_t, curl_off_t, curl_off_t) {
+    // Non-zero aborts the transfer with CURLE_ABORTED_BY_CALLBACK
+    return static_cast<const std::atomic<bool>*>(flag)->load() ? 1 : 0;
+}
+
+}  // namespace
+
+HttpClient::HttpClient() = default;
+
+HttpClient::~HttpClient() {
+    if (curl)
+        curl_easy_cleanup(curl);
+}
+
+void HttpClient::setCancelFlag(const std::atomic<bool>* flag) {
+    cancel = flag;
+}
+
+void HttpClient::setTimeouts(std::chrono::milliseconds connect, std::chrono::milliseconds total) {
+    connectTimeout = connect;
+    totalTimeout = total;
+}
+
+bool HttpClient::ensureHandle() {
+    // libcurl's global init (TLS backend included) is done once, explicitly
+    // and thread-safely, when the first request is made; curl_easy_init()
+    // would otherwise do it unsynchronized
+    static std::once_flag globalInit;
+    std::call_once(globalInit, [] { curl_global_init(CURL_GLOBAL_DEFAULT); });
+    if (!curl)
+        curl = curl_easy_init();
+    return curl != nullptr;
+}
+
+bool HttpClient::get(const std::string& url, std::string& body) {
+    if (!ensureHandle()) {
+        error = "CURL init failed";
+        return false;
+    }
+    curl_easy_reset(curl);
+    return perform(url, body);
+}
+
+bool HttpClient::post(const std::string& url, const std::string& data,
+                      const std::vector<std::string>& headers, std::string& body) {
+    if (!ensureHandle()) {
+        error = "CURL init failed";
+        return false;
+    }
+    curl_easy_reset(curl);
+
+    struct curl_slist* list = nullptr;
+    for (const std::string& header : headers)
+        list = curl_slist_append(list, header.c_str());
+
+    curl_easy_setopt(curl, CURLOPT_POST, 1L);
+    curl_easy_setopt(curl, CURLOPT_HTTPHEADER, list);
+    curl_easy_setopt(curl, CURLOPT_POSTFIELDS, data.data());
+    curl_easy_setopt(curl, CURLOPT_POSTFIELDSIZE_LARGE, static_cast<curl_off_t>(data.size()));
+    bool ok = perform(url, body);
+    curl_slist_free_all(list);
+    return ok;
+}
+
+bool HttpClient::perform(const std::string& url, std::string& body) {
+    static Counter& requests = MetricsRegistry::instance().counter("http_requests");
+    static Counter& failures = MetricsRegistry::instance().counter("http_errors");
+    static Counter& received = MetricsRegistry::instance().counter("http_bytes_received");
+
+    // curl_easy_reset() clears options but leaves the connection cache alone
+    body.clear();
+    curl_easy_setopt(curl, CURLOPT_URL, url.c_str());
+    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, appendBody);
+    curl_easy_setopt(curl, CURLOPT_WRITEDATA, &body);
+    curl_easy_setopt(curl, CURLOPT_FOLLOWLOCATION, 1L);
+    curl_easy_setopt(curl, CURLOPT_USERAGENT, "Mozilla/5.0");
+    curl_easy_setopt(curl, CURLOPT_CONNECTTIMEOUT_MS, static_cast<long>(connectTimeout.count()));
+    curl_easy_setopt(curl, CURLOPT_TIMEOUT_MS, static_cast<long>(totalTimeout.count()));
+    if (cancel) {
+        curl_easy_setopt(curl, CURLOPT_NOPROGRESS, 0L);
+        curl_easy_setopt(curl, CURLOPT_XFERINFOFUNCTION, checkCancelled);
+        curl_easy_setopt(curl, CURLOPT_XFERINFODATA, const_cast<std::atomic<bool>*>(cancel));
+    }
+
+    CURLcode res = curl_easy_perform(curl);
+    requests.add();
+    received.add(body.size());
+    if (res != CURLE_OK) {
+        failures.add();
+        error = curl_easy_strerror(res);
+        return false;
+    }
+    error.clear();
+    return true;
+}
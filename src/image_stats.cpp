@@ -0,0 +1,83 @@
+#include "image_stats.hpp"
+#include <vector>
+
+namespace {
+
+// Same fixed-point weights and rounding as cv::cvtColor(..., COLOR_BGR2GRAY)
+inline int32_t luma(int r, int g, int b) {
+    return (r * 4899 + g * 9617 + b * 1868 + (1 << 13)) >> 14;
+}
+
+// Sum of squared Laplacian responses along one row. The interior loop has
+// no branches so the compiler can vectorize it; the two border columns
+// reflect (x = -1 reads x = 1) like OpenCV's default border.
+int64_t laplacianRow(const int32_t* above, const int32_t* row, const int32_t* below, int width) {
+    auto at = [&](int x) {
+        int left = x > 0 ? x - 1 : (width > 1 ? 1 : 0);
+        int right = x < width - 1 ? x + 1 : (width > 1 ? width - 2 : 0);
+        int64_t v = above[x] + below[x] + row[left] + row[right] - 4 * row[x];
+        return v * v;
+    };
+
+    int64_t sum = at(0);
+    if (width > 1)
+        sum += at(width - 1);
+    for (int x = 1; x < width - 1; ++x) {
+        int32_t v = above[x] + below[x] + row[x - 1] + row[x + 1] - 4 * row[x];
+        sum += static_cast<int64_t>(v) * v;
+    }
+    return sum;
+}
+
+}  // namespace
+
+ImageStats computeImageStats(const ImageView& image) {
+    ImageStats stats;
+    if (image.empty())
+        return stats;
+
+    const int width = image.width;
+    const int height = image.height;
+    const PixelLayout& layout = image.layout;
+
+    std::vector<int32_t> rows[3];
+    for (auto& row : rows)
+        row.resize(width);
+    auto lumaRow = [&](int y) { return rows[y % 3].data(); };
+
+    uint64_t sumR = 0, sumG = 0, sumB = 0;
+    int64_t laplacian = 0;
+
+    for (int y = 0; y < height; ++y) {
+        const uint8_t* pixel = image.data + y * image.stride;
+        int32_t* out = lumaRow(y);
+        for (int x = 0; x < width; ++x, pixel += layout.bytesPerPixel) {
+            int r = pixel[layout.r];
+            int g = pixel[layout.g];
+            int b = pixel[layout.b];
+            sumR += r;
+            sumG += g;
+            sumB += b;
+            ++stats.histogram[(r >> 6) * 16 + (g >> 6) * 4 + (b >> 6)];
+            out[x] = luma(r, g, b);
+        }
+
+        // Row y completes the neighbourhood of row y - 1; row -1 reflects to row 1
+        if (y >= 1) {
+            const int32_t* above = y >= 2 ? lumaRow(y - 2) : lumaRow(y);
+            laplacian += laplacianRow(above, lumaRow(y - 1), lumaRow(y), width);
+        }
+    }
+
+    // Last row: row `height` reflects to row `height - 2`
+    const int32_t* last = lumaRow(height - 1);
+    const int32_t* neighbour = height > 1 ? lumaRow(height - 2) : last;
+    laplacian += laplacianRow(neighbour, last, neighbour, width);
+
+    const double pixels = static_cast<double>(width) * height;
+    stats.meanR = sumR / pixels;
+    stats.meanG = sumG / pixels;
+    stats.meanB = sumB / pixels;
+    stats.laplacianEnergy = laplacian / pixels;
+    return stats;
+}
@@ -0,0 +1,83 @@
+#include "image_view.hpp"
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+namespace {
+
+struct Tap {
+    int lo;         // first source index
+    int hi;         // second source index
+    float weight;   // weight of `hi`
+};
+
+// Source taps for each destination index along one axis
+std::vector<Tap> taps(int source, int destination) {
+    std::vector<Tap> result(destination);
+    const float scale = static_cast<float>(source) / destination;
+    for (int d = 0; d < destination; ++d) {
+        float position = (d + 0.5f) * scale - 0.5f;
+        int lo = static_cast<int>(std::floor(position));
+        float weight = position - lo;
+        if (lo < 0) {
+            lo = 0;
+            weight = 0.0f;
+        }
+        if (lo >= source - 1) {
+            lo = source - 1;
+            weight = 0.0f;
+        }
+        result[d] = {lo, std::min(lo + 1, source - 1), weight};
+    }
+    return result;
+}
+
+}  // namespace
+
+void writeTensor(const ImageView& image, int width, int height, bool channelsFirst, float* tensor,
+                 const TensorNormalization& normalization) {
+    const size_t planeSize = static_cast<size_t>(width) * height;
+    if (image.empty()) {
+        std::fill(tensor, tensor + planeSize * 3, 0.0f);
+        return;
+    }
+
+    const std::vector<Tap> columns = taps(image.width, width);
+    const std::vector<Tap> rows = taps(image.height, height);
+    const int bpp = image.layout.bytesPerPixel;
+    const int channel[3] = {normalization.rgb ? image.layout.r : image.layout.b, image.layout.g,
+                            normalization.rgb ? image.layout.b : image.layout.r};
+    // (v / 255 - mean) / stddev folded into one multiply-add
+    float scale[3], offset[3];
+    for (int c = 0; c < 3; ++c) {
+        scale[c] = 1.0f / (255.0f * normalization.stddev[c]);
+        offset[c] = -normalization.mean[c] / normalization.stddev[c];
+    }
+
+    for (int y = 0; y < height; ++y) {
+        const Tap& row = rows[y];
+        const uint8_t* top = image.data + row.lo * image.stride;
+        const uint8_t* bottom = image.data + row.hi * image.stride;
+        const float wy = row.weight;
+
+        for (int x = 0; x < width; ++x) {
+            const Tap& column = columns[x];
+            const uint8_t* p00 = top + column.lo * bpp;
+            const uint8_t* p01 = top + column.hi * bpp;
+            const uint8_t* p10 = bottom + column.lo * bpp;
+            const uint8_t* p11 = bottom + column.hi * bpp;
+            const float wx = column.weight;
+
+            for (int c = 0; c < 3; ++c) {
+                const int o = channel[c];
+                float upper = p00[o] + (p01[o] - p00[o]) * wx;
+                float lower = p10[o] + (p11[o] - p10[o]) * wx;
+                float value = (upper + (lower - upper) * wy) * scale[c] + offset[c];
+                if (channelsFirst)
+                    tensor[c * planeSize + static_cast<size_t>(y) * width + x] = value;
+                else
+                    tensor[(static_cast<size_t>(y) * width + x) * 3 + c] = value;
+            }
+        }
+    }
+}
@@ -0,0 +1,382 @@
+#include "match_server.hpp"
+#include "match_service.hpp"
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <sys/un.h>
+#include <poll.h>
+#include <signal.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+using json = nlohmann::json;
+
+namespace {
+
+// Longest request line accepted; a peer that sends more without a newline
+// is answered with an error and disconnected
+constexpr size_t kMaxLineBytes = 1 << 20;
+
+bool writeAll(int fd, const std::string& data) {
+    size_t sent = 0;
+    while (sent < data.size()) {
+        ssize_t n = ::send(fd, data.data() + sent, data.size() - sent, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            return false;
+        sent += static_cast<size_t>(n);
+    }
+    return true;
+}
+
+bool fillAddress(const std::string& path, sockaddr_un& address) {
+    std::memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(address.sun_path))
+        return false;
+    std::memcpy(address.sun_path, path.c_str(), path.size() + 1);
+    return true;
+}
+
+}  // namespace
+
+struct MatchServer::Connection {
+    explicit Connection(int fd) : fd(fd) {}
+    ~Connection() { ::close(fd); }
+
+    int fd;
+    std::mutex writeMutex;
+};
+
+MatchServer::MatchServer(RequestHandler& service, ServerOptions options)
+    : service(service), options(std::move(options)) {
+    if (this->options.workers == 0)
+        this->options.workers = std::max(1u, std::thread::hardware_concurrency());
+}
+
+MatchServer::~MatchServer() {
+    stop();
+    for (auto& worker : workers)
+        worker.join();
+    for (auto& reader : readers)
+        reader.thread.join();
+    if (listenFd >= 0) {
+        ::close(listenFd);
+        // Forked workers share the socket but must not remove it
+        if (::getpid() == ownerPid)
+            ::unlink(options.socketPath.c_str());
+    }
+}
+
+bool MatchServer::listen() {
+    sockaddr_un address;
+    if (!fillAddress(options.socketPath, address)) {
+        std::cerr << "Socket path too long: " << options.socketPath << "\n";
+        return false;
+    }
+
+    // Non-blocking so pre-forked workers that lose an accept() race go back to poll()
+    listenFd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC | SOCK_NONBLOCK, 0);
+    if (listenFd < 0) {
+        std::cerr << "socket() failed: " << std::strerror(errno) << "\n";
+        return false;
+    }
+
+    ::unlink(options.socketPath.c_str());
+    if (::bind(listenFd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0 ||
+        ::listen(listenFd, 64) < 0) {
+        std::cerr << "Cannot listen on " << options.socketPath << ": " << std::strerror(errno) << "\n";
+        ::close(listenFd);
+        listenFd = -1;
+        return false;
+    }
+    ownerPid = ::getpid();
+    return true;
+}
+
+void MatchServer::serve() {
+    for (size_t i = 0; i < options.workers; ++i)
+        workers.emplace_back([this] { workerLoop(); });
+
+    // Poll with a timeout so stop() from a signal handler is noticed
+    while (!stopping) {
+        pollfd pfd{listenFd, POLLIN, 0};
+        int ready = ::poll(&pfd, 1, 200);
+        if (ready <= 0)
+            continue;
+
+        int fd = ::accept4(listenFd, nullptr, nullptr, SOCK_CLOEXEC);
+        if (fd < 0)
+            continue;
+
+        auto connection = std::make_shared<Connection>(fd);
+        auto done = std::make_shared<std::atomic<bool>>(false);
+        std::lock_guard<std::mutex> lock(connectionsMutex);
+        reapReaders();
+        connections.push_back(connection);
+        readers.push_back({std::thread([this, connection, done] {
+            readConnection(connection);
+            *done = true;
+        }), done});
+    }
+
+    // Wake readers blocked in recv() and workers waiting for jobs
+    {
+        std::lock_guard<std::mutex> lock(connectionsMutex);
+        for (auto& weak : connections)
+            if (auto connection = weak.lock())
+                ::shutdown(connection->fd, SHUT_RDWR);
+    }
+    queueReady.notify_all();
+}
+
+// Joins reader threads whose client has gone away. Called with connectionsMutex held.
+void MatchServer::reapReaders() {
+    auto finished = std::partition(readers.begin(), readers.end(),
+                                   [](const Reader& reader) { return !*reader.done; });
+    for (auto it = finished; it != readers.end(); ++it)
+        it->thread.join();
+    readers.erase(finished, readers.end());
+
+    connections.erase(std::remove_if(connections.begin(), connections.end(),
+                                     [](const std::weak_ptr<Connection>& weak) { return weak.expired(); }),
+                      connections.end());
+}
+
+void MatchServer::servePreforked(size_t processes) {
+    using Clock = std::chrono::steady_clock;
+    // A worker that exits sooner than this after starting counts as failing
+    // to start; after kMaxQuickExits of those in a row its slot is given up
+    constexpr auto kQuickExit = std::chrono::seconds(10);
+    constexpr int kMaxQuickExits = 5;
+
+    struct Slot {
+        pid_t pid = -1;
+        Clock::time_point started;
+        Clock::time_point respawnAt;
+        int quickExits = 0;
+        bool abandoned = false;
+    };
+    std::vector<Slot> slots(processes);
+
+    auto spawn = [&](Slot& slot) {
+        pid_t pid = ::fork();
+        if (pid == 0) {
+            serve();
+            for (auto& worker : workers)
+                worker.join();
+            for (auto& reader : readers)
+                reader.thread.join();
+            std::_Exit(0);
+        }
+        slot.started = Clock::now();
+        if (pid > 0) {
+            slot.pid = pid;
+            return;
+        }
+        std::cerr << "fork() failed: " << std::strerror(errno) << "\n";
+        ++slot.quickExits;
+        slot.respawnAt = slot.started + std::chrono::seconds(1);
+    };
+    auto live = [&] {
+        return std::any_of(slots.begin(), slots.end(), [](const Slot& slot) { return !slot.abandoned; });
+    };
+
+    for (Slot& slot : slots)
+        spawn(slot);
+
+    while (!stopping && live()) {
+        int status = 0;
+        pid_t pid = ::waitpid(-1, &status, WNOHANG);
+        auto now = Clock::now();
+        if (pid > 0) {
+            auto it = std::find_if(slots.begin(), slots.end(), [pid](const Slot& slot) { return slot.pid == pid; });
+            if (it != slots.end()) {
+                Slot& slot = *it;
+                slot.pid = -1;
+                slot.quickExits = now - slot.started < kQuickExit ? slot.quickExits + 1 : 0;
+                if (slot.quickExits >= kMaxQuickExits) {
+                    slot.abandoned = true;
+                    std::cerr << "Worker " << pid << " exited " << slot.quickExits
+                              << " times in a row right after starting; not restarting it\n";
+                } else {
+                    // 0.2 s, doubling with each quick exit up to 3.2 s
+                    slot.respawnAt = now + std::chrono::milliseconds(200) * (1 << slot.quickExits);
+                    std::cerr << "Worker " << pid << " exited, restarting\n";
+                }
+            }
+            continue;
+        }
+
+        for (Slot& slot : slots)
+            if (slot.pid < 0 && !slot.abandoned && now >= slot.respawnAt)
+                spawn(slot);
+        ::usleep(200 * 1000);
+    }
+
+    for (const Slot& slot : slots)
+        if (slot.pid > 0)
+            ::kill(slot.pid, SIGTERM);
+    for (const Slot& slot : slots)
+        if (slot.pid > 0)
+            ::waitpid(slot.pid, nullptr, 0);
+}
+
+void MatchServer::stop() {
+    stopping = true;
+}
+
+void MatchServer::readConnection(std::shared_ptr<Connection> connection) {
+    std::string buffer;
+    char chunk[4096];
+
+    while (!stopping) {
+        ssize_t n = ::recv(connection->fd, chunk, sizeof(chunk), 0);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            break;
+        buffer.append(chunk, static_cast<size_t>(n));
+        if (buffer.size() > kMaxLineBytes && buffer.find('\n') == std::string::npos) {
+            respond(*connection, json::object(), {{"error", "request too long"}});
+            break;
+        }
+
+        size_t newline;
+        while ((newline = buffer.find('\n')) != std::string::npos) {
+            std::string line = buffer.substr(0, newline);
+            buffer.erase(0, newline + 1);
+            if (line.find_first_not_of(" \t\r") == std::string::npos)
+                continue;
+
+            Job job;
+            job.connection = connection;
+            int deadlineMs = options.defaultDeadlineMs;
+            try {
+                job.request = json::parse(line);
+                if (job.request.is_object() && job.request.contains("deadline_ms")) {
+                    const json& deadline = job.request["deadline_ms"];
+                    if (!deadline.is_number_integer()) {
+                        respond(*connection, job.request, {{"error", "bad request: deadline_ms must be an integer"}});
+                        continue;
+                    }
+                    deadlineMs = deadline.get<int>();
+                }
+            } catch (const json::exception& e) {
+                respond(*connection, job.request, {{"error", std::string("bad request: ") + e.what()}});
+                continue;
+            }
+            if (deadlineMs > 0) {
+                job.hasDeadline = true;
+                job.deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(deadlineMs);
+            }
+
+            bool accepted = false;
+            {
+                std::lock_guard<std::mutex> lock(queueMutex);
+                if (queue.size() < options.queueCapacity) {
+                    queue.push_back(std::move(job));
+                    accepted = true;
+                }
+            }
+            if (accepted)
+                queueReady.notify_one();
+            else
+                respond(*connection, job.request, {{"error", "overloaded"}});
+        }
+    }
+}
+
+void MatchServer::workerLoop() {
+    for (;;) {
+        Job job;
+        {
+            std::unique_lock<std::mutex> lock(queueMutex);
+            queueReady.wait(lock, [this] { return stopping || !queue.empty(); });
+            if (stopping)
+                return;
+            job = std::move(queue.front());
+            queue.pop_front();
+        }
+
+        if (job.hasDeadline && std::chrono::steady_clock::now() > job.deadline) {
+            respond(*job.connection, job.request, {{"error", "deadline exceeded"}});
+            continue;
+        }
+        respond(*job.connection, job.request, service.handle(job.request));
+    }
+}
+
+void MatchServer::respond(Connection& connection, const json& request, json response) {
+    if (request.is_object() && request.contains("seq"))
+        response["seq"] = request["seq"];
+    std::string line = response.dump(-1, ' ', false, json::error_handler_t::replace);
+    line += '\n';
+    std::lock_guard<std::mutex> lock(connection.writeMutex);
+    writeAll(connection.fd, line);
+}
+
+MatchClient::~MatchClient() {
+    if (fd >= 0)
+        ::close(fd);
+}
+
+bool MatchClient::connect(const std::string& socketPath) {
+    sockaddr_un address;
+    if (!fillAddress(socketPath, address))
+        return false;
+    fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0)
+        return false;
+    if (::connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0) {
+        ::close(fd);
+        fd = -1;
+        return false;
+    }
+    return true;
+}
+
+bool MatchClient::call(const json& request, json& response, std::chrono::milliseconds timeout) {
+    using Clock = std::chrono::steady_clock;
+    const bool bounded = timeout != std::chrono::milliseconds::max();
+    const auto deadline = bounded ? Clock::now() + timeout : Clock::time_point::max();
+    if (fd < 0 || !writeAll(fd, request.dump() + "\n"))
+        return false;
+
+    char chunk[4096];
+    size_t newline;
+    while ((newline = pending.find('\n')) == std::string::npos) {
+        if (bounded) {
+            auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - Clock::now());
+            pollfd pfd{fd, POLLIN, 0};
+            int ready = remaining.count() > 0 ? ::poll(&pfd, 1, static_cast<int>(remaining.count())) : 0;
+            if (ready < 0 && errno == EINTR)
+                continue;
+            if (ready <= 0) {
+                ::close(fd);
+                fd = -1;
+                pending.clear();
+                return false;
+            }
+        }
+        ssize_t n = ::recv(fd, chunk, sizeof(chunk), 0);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            return false;
+        pending.append(chunk, static_cast<size_t>(n));
+    }
+
+    std::string line = pending.substr(0, newline);
+    pending.erase(0, newline + 1);
+    try {
+        response = json::parse(line);
+    } catch (const json::exception&) {
+        return false;
+    }
+    return true;
+}
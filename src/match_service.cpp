@@ -0,0 +1,73 @@
+#include "match_service.hpp"
+#include "onnx_face_compare.hpp"
+#include <opencv2/imgcodecs.hpp>
+#include <mutex>
+#include <stdexcept>
+
+using json = nlohmann::json;
+
+MatchService::MatchService(FaceEmbeddingExtractor& extractor, Gallery gallery, std::string galleryPath)
+    : extractor(extractor), gallery(std::move(gallery)), galleryPath(std::move(galleryPath)) {}
+
+std::vector<float> MatchService::embeddingFor(const json& request, const char* imageKey, const char* embeddingKey) {
+    if (request.contains(embeddingKey))
+        return request.at(embeddingKey).get<std::vector<float>>();
+
+    std::string path = request.at(imageKey).get<std::string>();
+    cv::Mat img = cv::imread(path, cv::IMREAD_COLOR);
+    if (img.empty())
+        throw std::runtime_error("cannot read image: " + path);
+    return extractor.getEmbedding(img);
+}
+
+json MatchService::handle(const json& request) {
+    json response;
+    try {
+        std::string op = request.at("op").get<std::string>();
+
+        if (op == "ping") {
+            response["ok"] = true;
+        } else if (op == "embed") {
+            response["embedding"] = embeddingFor(request, "image", "embedding");
+        } else if (op == "enroll") {
+            if (readOnly)
+                throw std::runtime_error("gallery is read-only");
+            std::string id = request.at("id").get<std::string>();
+            std::vector<float> embedding = embeddingFor(request, "image", "embedding");
+            std::unique_lock<std::shared_mutex> lock(galleryMutex);
+            if (!gallery.add(id, embedding))
+                throw std::runtime_error("embedding size does not match gallery");
+            response["size"] = gallery.size();
+        } else if (op == "query") {
+            std::vector<float> embedding = embeddingFor(request, "image", "embedding");
+            size_t topK = request.value("top_k", size_t(5));
+            float threshold = request.value("threshold", 0.5f);
+
+            json matches = json::array();
+            std::shared_lock<std::shared_mutex> lock(galleryMutex);
+            for (const auto& match : gallery.query(embedding, topK, threshold))
+                matches.push_back({{"id", match.id}, {"score", match.score}});
+            response["matches"] = std::move(matches);
+        } else if (op == "verify") {
+            std::vector<float> a = embeddingFor(request, "image", "embedding");
+            std::vector<float> b = embeddingFor(request, "image2", "embedding2");
+            response["score"] = extractor.compareEmbeddings(a, b);
+        } else if (op == "save") {
+            if (readOnly || !saveGallery())
+                throw std::runtime_error("cannot save gallery");
+            response["ok"] = true;
+        } else {
+            throw std::runtime_error("unknown op: " + op);
+        }
+    } catch (const std::exception& e) {
+        response = {{"error", e.what()}};
+    }
+    return response;
+}
+
+bool MatchService::saveGallery() {
+    if (galleryPath.empty())
+        return false;
+    std::shared_lock<std::shared_mutex> lock(galleryMutex);
+    return gallery.save(galleryPath);
+}
@@ -0,0 +1,140 @@
+#include "metrics.hpp"
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#ifdef __linux__
+#include <unistd.h>
+#endif
+
+int Histogram::bucketFor(uint64_t micros) {
+    if (micros < static_cast<uint64_t>(kSubBuckets))
+        return static_cast<int>(micros);
+    int exponent = 63 - __builtin_clzll(micros);
+    int sub = static_cast<int>((micros >> (exponent - kSubBucketBits)) & (kSubBuckets - 1));
+    return (exponent - kSubBucketBits + 1) * kSubBuckets + sub;
+}
+
+uint64_t Histogram::bucketStart(int bucket) {
+    if (bucket < kSubBuckets)
+        return static_cast<uint64_t>(bucket);
+    int exponent = bucket / kSubBuckets + kSubBucketBits - 1;
+    uint64_t sub = static_cast<uint64_t>(bucket % kSubBuckets);
+    return (kSubBuckets + sub) << (exponent - kSubBucketBits);
+}
+
+size_t metricShard() {
+    static std::atomic<size_t> nextShard{0};
+    thread_local size_t shard = nextShard.fetch_add(1, std::memory_order_relaxed) % kMetricShards;
+    return shard;
+}
+
+uint64_t Counter::value() const {
+    uint64_t total = 0;
+    for (const Shard& shard : shards)
+        total += shard.count.load(std::memory_order_relaxed);
+    return total;
+}
+
+void Histogram::record(double ms) {
+    uint64_t micros = ms > 0.0 ? static_cast<uint64_t>(std::llround(ms * 1000.0)) : 0;
+    Shard& shard = shards[metricShard()];
+    shard.buckets[bucketFor(micros)].fetch_add(1, std::memory_order_relaxed);
+    shard.sumMicros.fetch_add(micros, std::memory_order_relaxed);
+    // Usually the only writer, so this rarely loops
+    uint64_t seen = shard.maxMicros.load(std::memory_order_relaxed);
+    while (micros > seen && !shard.maxMicros.compare_exchange_weak(seen, micros, std::memory_order_relaxed)) {
+    }
+}
+
+HistogramSnapshot Histogram::snapshot() const {
+    HistogramSnapshot result;
+    result.buckets.assign(kBucketCount, 0);
+    uint64_t sumMicros = 0, maxMicros = 0;
+    for (const Shard& shard : shards) {
+        for (int i = 0; i < kBucketCount; ++i)
+            result.buckets[i] += shard.buckets[i].load(std::memory_order_relaxed);
+        sumMicros += shard.sumMicros.load(std::memory_order_relaxed);
+        maxMicros = std::max(maxMicros, shard.maxMicros.load(std::memory_order_relaxed));
+    }
+    for (uint64_t bucket : result.buckets)
+        result.count += bucket;
+    result.sumMs = sumMicros / 1000.0;
+    result.maxMs = maxMicros / 1000.0;
+    return result;
+}
+
+double HistogramSnapshot::quantile(double q) const {
+    if (count == 0 || buckets.empty())
+        return 0.0;
+    uint64_t rank = static_cast<uint64_t>(std::ceil(std::clamp(q, 0.0, 1.0) * count));
+    rank = std::max<uint64_t>(rank, 1);
+    uint64_t seen = 0;
+    for (size_t i = 0; i < buckets.size(); ++i) {
+        seen += buckets[i];
+        if (seen >= rank) {
+            // Middle of the bucket, but never past the largest value recorded
+            int bucket = static_cast<int>(i);
+            double low = Histogram::bucketStart(bucket) / 1000.0;
+            double high = bucket + 1 < Histogram::kBucketCount ? Histogram::bucketStart(bucket + 1) / 1000.0 : low;
+            return std::min((low + high) / 2.0, maxMs);
+        }
+    }
+    return maxMs;
+}
+
+MetricsRegistry& MetricsRegistry::instance() {
+    static MetricsRegistry registry;
+    return registry;
+}
+
+namespace {
+
+template <typename T>
+T& lookup(std::map<std::string, std::unique_ptr<T>>& metrics, const std::string& name) {
+    std::unique_ptr<T>& metric = metrics[name];
+    if (!metric)
+        metric = std::make_unique<T>();
+    return *metric;
+}
+
+}  // namespace
+
+Counter& MetricsRegistry::counter(const std::string& name) {
+    std::lock_guard<std::mutex> lock(mutex);
+    return lookup(counters, name);
+}
+
+Gauge& MetricsRegistry::gauge(const std::string& name) {
+    std::lock_guard<std::mutex> lock(mutex);
+    return lookup(gauges, name);
+}
+
+Histogram& MetricsRegistry::histogram(const std::string& name) {
+    std::lock_guard<std::mutex> lock(mutex);
+    return lookup(histograms, name);
+}
+
+MetricsSnapshot MetricsRegistry::snapshot() const {
+    MetricsSnapshot result;
+    std::lock_guard<std::mutex> lock(mutex);
+    for (const auto& [name, counter] : counters)
+        result.counters[name] = counter->value();
+    for (const auto& [name, gauge] : gauges)
+        result.gauges[name] = gauge->value();
+    for (const auto& [name, histogram] : histograms)
+        result.histograms[name] = histogram->snapshot();
+    return result;
+}
+
+size_t residentMemoryBytes() {
+#ifdef __linux__
+    // Second field of statm is the resident page count
+    std::ifstream statm("/proc/self/statm");
+    size_t pages = 0, resident = 0;
+    if (!(statm >> pages >> resident))
+        return 0;
+    return resident * static_cast<size_t>(sysconf(_SC_PAGESIZE));
+#else
+    return 0;
+#endif
+}
@@ -0,0 +1,180 @@
+#include "metrics_export.hpp"
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <poll.h>
+#include <unistd.h>
+#include <cctype>
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <sstream>
+
+using json = nlohmann::json;
+
+namespace {
+
+const double kQuantiles[] = {0.5, 0.9, 0.95, 0.99, 0.999};
+
+std::string promName(const std::string& name) {
+    std::string result = "facereco_";
+    for (char c : name)
+        result += std::isalnum(static_cast<unsigned char>(c)) ? c : '_';
+    return result;
+}
+
+bool endsWith(const std::string& text, const std::string& suffix) {
+    return text.size() >= suffix.size() && text.compare(text.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+void writeAll(int fd, const std::string& data) {
+    size_t sent = 0;
+    while (sent < data.size()) {
+        ssize_t n = ::send(fd, data.data() + sent, data.size() - sent, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            return;
+        sent += static_cast<size_t>(n);
+    }
+}
+
+}  // namespace
+
+std::string prometheusText(const MetricsSnapshot& snapshot) {
+    std::ostringstream out;
+    for (const auto& [name, value] : snapshot.counters) {
+        std::string metric = promName(name) + "_total";
+        out << "# TYPE " << metric << " counter\n" << metric << " " << value << "\n";
+    }
+    for (const auto& [name, value] : snapshot.gauges) {
+        std::string metric = promName(name);
+        out << "# TYPE " << metric << " gauge\n" << metric << " " << value << "\n";
+    }
+    for (const auto& [name, histogram] : snapshot.histograms) {
+        std::string metric = promName(endsWith(name, "_ms") ? name.substr(0, name.size() - 3) + "_seconds" : name);
+        out << "# TYPE " << metric << " summary\n";
+        for (double q : kQuantiles)
+            out << metric << "{quantile=\"" << q << "\"} " << histogram.quantile(q) / 1000.0 << "\n";
+        out << metric << "_sum " << histogram.sumMs / 1000.0 << "\n"
+            << metric << "_count " << histogram.count << "\n";
+    }
+    return out.str();
+}
+
+json metricsJson(const MetricsSnapshot& snapshot) {
+    json histograms = json::object();
+    for (const auto& [name, histogram] : snapshot.histograms) {
+        histograms[name] = {
+            {"count", histogram.count},
+            {"mean_ms", histogram.meanMs()},
+            {"p50_ms", histogram.quantile(0.5)},
+            {"p90_ms", histogram.quantile(0.9)},
+            {"p95_ms", histogram.quantile(0.95)},
+            {"p99_ms", histogram.quantile(0.99)},
+            {"p999_ms", histogram.quantile(0.999)},
+            {"max_ms", histogram.maxMs},
+        };
+    }
+    return {
+        {"counters", snapshot.counters},
+        {"gauges", snapshot.gauges},
+        {"histograms", histograms},
+    };
+}
+
+MetricsServer::MetricsServer(int port) : port(port) {}
+
+MetricsServer::~MetricsServer() {
+    stop();
+    if (thread.joinable())
+        thread.join();
+    if (listenFd >= 0)
+        ::close(listenFd);
+}
+
+bool MetricsServer::start() {
+    listenFd = ::socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (listenFd < 0) {
+        std::cerr << "socket() failed: " << std::strerror(errno) << "\n";
+        return false;
+    }
+    int reuse = 1;
+    ::setsockopt(listenFd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+
+    // Loopback only: metrics are for a local scraper or an SSH tunnel
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    address.sin_port = htons(static_cast<uint16_t>(port));
+    if (::bind(listenFd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0 ||
+        ::listen(listenFd, 16) < 0) {
+        std::cerr << "Cannot serve metrics on port " << port << ": " << std::strerror(errno) << "\n";
+        ::close(listenFd);
+        listenFd = -1;
+        return false;
+    }
+    thread = std::thread([this] { serve(); });
+    return true;
+}
+
+void MetricsServer::stop() {
+    stopping = true;
+}
+
+void MetricsServer::serve() {
+    // Poll with a timeout so stop() is noticed
+    while (!stopping) {
+        pollfd pfd{listenFd, POLLIN, 0};
+        if (::poll(&pfd, 1, 200) <= 0)
+            continue;
+        int fd = ::accept4(listenFd, nullptr, nullptr, SOCK_CLOEXEC);
+        if (fd < 0)
+            continue;
+        answer(fd);
+        ::close(fd);
+    }
+}
+
+void MetricsServer::answer(int fd) {
+    // A scraper that never finishes its request must not stall the loop
+    timeval timeout{1, 0};
+    ::setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+    std::string request;
+    char chunk[1024];
+    while (request.find("\r\n\r\n") == std::string::npos && request.size() < 8192) {
+        ssize_t n = ::recv(fd, chunk, sizeof(chunk), 0);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            break;
+        request.append(chunk, static_cast<size_t>(n));
+    }
+
+    std::istringstream line(request.substr(0, request.find("\r\n")));
+    std::string method, path;
+    line >> method >> path;
+
+    std::string status = "200 OK", type, body;
+    if (method != "GET") {
+        status = "405 Method Not Allowed";
+    } else if (path == "/metrics") {
+        type = "text/plain; version=0.0.4";
+        body = prometheusText(MetricsRegistry::instance().snapshot());
+    } else if (path == "/metrics.json") {
+        type = "application/json";
+        body = metricsJson(MetricsRegistry::instance().snapshot()).dump();
+    } else {
+        status = "404 Not Found";
+    }
+
+    std::ostringstream response;
+    response << "HTTP/1.0 " << status << "\r\n";
+    if (!type.empty())
+        response << "Content-Type: " << type << "\r\n";
+    response << "Content-Length: " << body.size() << "\r\n"
+             << "Connection: close\r\n\r\n"
+             << body;
+    writeAll(fd, response.str());
+}
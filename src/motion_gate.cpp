@@ -0,0 +1,64 @@
+#include "motion_gate.hpp"
+#include <opencv2/imgproc.hpp>
+#include <algorithm>
+
+namespace {
+
+constexpr int kHistogramBins = 32;
+
+void histogramOf(const cv::Mat& gray, cv::Mat& hist) {
+    const int channels[] = {0};
+    const int bins[] = {kHistogramBins};
+    const float range[] = {0.0f, 256.0f};
+    const float* ranges[] = {range};
+    cv::calcHist(&gray, 1, channels, cv::Mat(), hist, 1, bins, ranges);
+}
+
+}  // namespace
+
+MotionGate::MotionGate(MotionGateOptions options) : options(options) {}
+
+float MotionGate::score() {
+    cv::absdiff(small, reference, diff);
+    float motion = static_cast<float>(cv::countNonZero(diff > options.noiseLevel)) /
+                   static_cast<float>(small.total());
+    float scene = static_cast<float>(cv::compareHist(referenceHist, hist, cv::HISTCMP_BHATTACHARYYA));
+    return std::max(motion, scene);
+}
+
+bool MotionGate::admit(const cv::Mat& frame) {
+    if (frame.empty())
+        return false;
+
+    // Shrink first so the colour conversion only touches the thumbnail
+    cv::resize(frame, scaled, options.analysisSize, 0, 0, cv::INTER_AREA);
+    if (scaled.channels() == 1)
+        scaled.copyTo(small);
+    else
+        cv::cvtColor(scaled, small, scaled.channels() == 4 ? cv::COLOR_BGRA2GRAY : cv::COLOR_BGR2GRAY);
+    histogramOf(small, hist);
+
+    bool pass = true;
+    if (!reference.empty() && skipped < options.maxSkippedFrames) {
+        lastActivity = score();
+        pass = lastActivity >= options.threshold;
+    } else {
+        lastActivity = 1.0f;
+    }
+
+    if (pass) {
+        small.copyTo(reference);
+        hist.copyTo(referenceHist);
+        skipped = 0;
+    } else {
+        ++skipped;
+    }
+    return pass;
+}
+
+void MotionGate::reset() {
+    reference.release();
+    referenceHist.release();
+    skipped = 0;
+    lastActivity = 1.0f;
+}
@@ -1,73 +1,181 @@
-#include <onnxruntime_cxx_api.h>
-#include <opencv2/opencv.hpp>
-#include <vector>
-#include <string>
-#include <iostream>
+#include "onnx_face_compare.hpp"
+#include "ort_runtime.hpp"
+#include "metrics.hpp"
+#include "trace.hpp"
+#include <algorithm>
+#include <array>
+#include <chrono>
 #include <cmath>
 
-class FaceEmbeddingExtractor {
-public:
-    FaceEmbeddingExtractor(const std::string& modelPath)
-        : env(ORT_LOGGING_LEVEL_WARNING, "FaceNet"), session(nullptr), memoryInfo(nullptr) {
-        Ort::SessionOptions sessionOptions;
-        sessionOptions.SetIntraOpNumThreads(1);
-        sessionOptions.SetGraphOptimizationLevel(GraphOptimizationLevel::ORT_ENABLE_ALL);
-        session = Ort::Session(env, modelPath.c_str(), sessionOptions);
-        memoryInfo = Ort::MemoryInfo::CreateCpu(OrtDeviceAllocator, OrtMemTypeCPU);
+namespace {
+
+std::vector<float> l2Normalize(std::vector<float> vec) {
+    float norm = 0.0f;
+    for (float v : vec) norm += v * v;
+    norm = std::sqrt(norm) + 1e-10f;
+    for (float& v : vec)
+        v /= norm;
+    return vec;
+}
+
+// A view of an 8-bit BGR, BGRA or gray Mat; other depths are converted into `holder`
+ImageView viewOf(const cv::Mat& image, cv::Mat& holder) {
+    const cv::Mat* source = &image;
+    if (image.depth() != CV_8U) {
+        image.convertTo(holder, CV_8U);
+        source = &holder;
+    }
+    ImageView view;
+    view.data = source->data;
+    view.width = source->cols;
+    view.height = source->rows;
+    view.stride = source->step;
+    view.layout = source->channels() == 4 ? layouts::Bgra
+                : source->channels() == 1 ? layouts::Gray
+                : layouts::Bgr;
+    return view;
+}
+
+}  // namespace
+
+FaceEmbeddingExtractor::FaceEmbeddingExtractor(const std::string& modelPath, int intraOpThreads,
+                                               const TensorNormalization& normalization)
+    : session(nullptr), memoryInfo(nullptr), normalization(normalization) {
+    SessionSettings settings;
+    settings.intraOpThreads = intraOpThreads;
+    // Per-node timings for the trace; handed to the tracer on destruction
+    profiling = Tracer::instance().profilingOrt();
+    if (profiling)
+        settings.profilePrefix = "facereco_ort";
+    session = OrtRuntime::instance().createSession(modelPath, settings);
+    memoryInfo = Ort::MemoryInfo::CreateCpu(OrtDeviceAllocator, OrtMemTypeCPU);
+
+    Ort::AllocatorWithDefaultOptions allocator;
+    inputName = session.GetInputNameAllocated(0, allocator).get();
+    outputName = session.GetOutputNameAllocated(0, allocator).get();
+
+    // Either [N, H, W, 3] or [N, 3, H, W]; dynamic dimensions keep the FaceNet default
+    std::vector<int64_t> inputShape = session.GetInputTypeInfo(0).GetTensorTypeAndShapeInfo().GetShape();
+    if (inputShape.size() == 4) {
+        dynamicBatch = inputShape[0] <= 0;
+        channelsFirst = inputShape[1] == 3;
+        int64_t h = channelsFirst ? inputShape[2] : inputShape[1];
+        int64_t w = channelsFirst ? inputShape[3] : inputShape[2];
+        if (h > 0) height = static_cast<int>(h);
+        if (w > 0) width = static_cast<int>(w);
     }
 
-    std::vector<float> getEmbedding(const cv::Mat& face) {
-        cv::Mat resized;
-        cv::resize(face, resized, cv::Size(160, 160)); // FaceNet input size
-        resized.convertTo(resized, CV_32FC3, 1.0f / 255.0f);
+    std::vector<int64_t> outputShape = session.GetOutputTypeInfo(0).GetTensorTypeAndShapeInfo().GetShape();
+    if (!outputShape.empty() && outputShape.back() > 0)
+        outputSize = static_cast<size_t>(outputShape.back());
+}
 
-        std::vector<float> inputTensorValues;
-        inputTensorValues.reserve(160 * 160 * 3);
-        for (int i = 0; i < 160; ++i)
-            for (int j = 0; j < 160; ++j)
-                for (int c = 0; c < 3; ++c)
-                    inputTensorValues.push_back(resized.at<cv::Vec3f>(i, j)[c]);
+FaceEmbeddingExtractor::~FaceEmbeddingExtractor() {
+    if (!profiling)
+        return;
+    try {
+        Ort::AllocatorWithDefaultOptions allocator;
+        auto profile = session.EndProfilingAllocated(allocator);
+        Tracer::instance().addOrtProfile(profile.get(), session.GetProfilingStartTimeNs());
+    } catch (const Ort::Exception&) {
+        // Profiling output is best effort
+    }
+}
 
-        std::array<int64_t, 4> inputShape = {1, 160, 160, 3};
+std::vector<std::vector<float>> FaceEmbeddingExtractor::run(const ImageView* faces, size_t count) {
+    using Clock = std::chrono::steady_clock;
+    static Histogram& preprocessTime = MetricsRegistry::instance().histogram("preprocess_ms");
+    static Histogram& inferenceTime = MetricsRegistry::instance().histogram("inference_ms");
+    static Counter& inferred = MetricsRegistry::instance().counter("faces_embedded");
 
-        Ort::Value inputTensor = Ort::Value::CreateTensor<float>(
-            memoryInfo, inputTensorValues.data(), inputTensorValues.size(),
-            inputShape.data(), inputShape.size()
-        );
+    // Pixels go straight from the caller's buffer into the input tensor
+    auto preprocessStart = Clock::now();
+    const size_t imageSize = static_cast<size_t>(width) * height * 3;
+    std::vector<float> inputTensorValues(imageSize * count);
+    {
+        TraceSpan span("preprocess", "model");
+        span.setItems(static_cast<int64_t>(count));
+        for (size_t i = 0; i < count; ++i)
+            writeTensor(faces[i], width, height, channelsFirst, inputTensorValues.data() + i * imageSize,
+                        normalization);
+    }
+    auto inferenceStart = Clock::now();
+    preprocessTime.record(std::chrono::duration<double, std::milli>(inferenceStart - preprocessStart).count());
 
-        const char* inputNames[] = {"input"};
-        const char* outputNames[] = {"embeddings"};
+    const int64_t batch = static_cast<int64_t>(count);
+    std::array<int64_t, 4> inputShape = channelsFirst
+        ? std::array<int64_t, 4>{batch, 3, height, width}
+        : std::array<int64_t, 4>{batch, height, width, 3};
 
-        auto output = session.Run(Ort::RunOptions{nullptr},
-                                  inputNames, &inputTensor, 1,
-                                  outputNames, 1);
+    Ort::Value inputTensor = Ort::Value::CreateTensor<float>(
+        memoryInfo, inputTensorValues.data(), inputTensorValues.size(),
+        inputShape.data(), inputShape.size()
+    );
 
-        float* floatArray = output[0].GetTensorMutableData<float>();
-        size_t numElements = output[0].GetTensorTypeAndShapeInfo().GetElementCount();
+    const char* inputNames[] = {inputName.c_str()};
+    const char* outputNames[] = {outputName.c_str()};
 
-        std::vector<float> embedding(floatArray, floatArray + numElements);
-        return l2Normalize(embedding);
+    std::vector<Ort::Value> output;
+    {
+        TraceSpan span("inference", "model");
+        span.setItems(static_cast<int64_t>(count));
+        output = session.Run(Ort::RunOptions{nullptr},
+                             inputNames, &inputTensor, 1,
+                             outputNames, 1);
     }
+    // One sample per Run(), whatever the batch size
+    inferenceTime.record(std::chrono::duration<double, std::milli>(Clock::now() - inferenceStart).count());
+    inferred.add(count);
 
-    float compareEmbeddings(const std::vector<float>& a, const std::vector<float>& b) {
-        float dot = 0.0f;
-        for (size_t i = 0; i < a.size(); ++i)
-            dot += a[i] * b[i];
-        return dot; // Cosine similarity, as vectors are normalized
+    const float* floatArray = output[0].GetTensorMutableData<float>();
+    size_t rowSize = output[0].GetTensorTypeAndShapeInfo().GetElementCount() / count;
+
+    std::vector<std::vector<float>> embeddings;
+    embeddings.reserve(count);
+    for (size_t i = 0; i < count; ++i) {
+        const float* row = floatArray + i * rowSize;
+        embeddings.push_back(l2Normalize(std::vector<float>(row, row + rowSize)));
     }
+    return embeddings;
+}
+
+std::vector<float> FaceEmbeddingExtractor::getEmbedding(const cv::Mat& face) {
+    cv::Mat holder;
+    ImageView view = viewOf(face, holder);
+    return getEmbedding(view);
+}
 
-private:
-    std::vector<float> l2Normalize(const std::vector<float>& vec) {
-        float norm = 0.0f;
-        for (float v : vec) norm += v * v;
-        norm = std::sqrt(norm);
-        std::vector<float> normalized(vec.size());
-        for (size_t i = 0; i < vec.size(); ++i)
-            normalized[i] = vec[i] / norm;
-        return normalized;
+std::vector<float> FaceEmbeddingExtractor::getEmbedding(const ImageView& face) {
+    return std::move(run(&face, 1).front());
+}
+
+std::vector<std::vector<float>> FaceEmbeddingExtractor::getEmbeddings(const std::vector<cv::Mat>& faces) {
+    if (faces.empty())
+        return {};
+    if (dynamicBatch) {
+        std::vector<cv::Mat> holders(faces.size());
+        std::vector<ImageView> views;
+        views.reserve(faces.size());
+        for (size_t i = 0; i < faces.size(); ++i)
+            views.push_back(viewOf(faces[i], holders[i]));
+        return run(views.data(), views.size());
     }
 
-    Ort::Env env;
-    Ort::Session session;
-    Ort::MemoryInfo memoryInfo;
-};
+    std::vector<std::vector<float>> embeddings;
+    embeddings.reserve(faces.size());
+    for (const cv::Mat& face : faces)
+        embeddings.push_back(getEmbedding(face));
+    return embeddings;
+}
+
+float FaceEmbeddingExtractor::compareEmbeddings(const std::vector<float>& a, const std::vector<float>& b) const {
+    float dot = 0.0f;
+    for (size_t i = 0; i < a.size() && i < b.size(); ++i)
+        dot += a[i] * b[i];
+    return dot; // Cosine similarity, as vectors are normalized
+}
+
+FaceEmbeddingExtractor& defaultFaceEmbedder() {
+    static FaceEmbeddingExtractor extractor(kDefaultModelPath);
+    return extractor;
+}
@@ -0,0 +1,246 @@
+#include "ort_runtime.hpp"
+#include "metrics.hpp"
+#include <unistd.h>
+#if defined(__aarch64__) && defined(__linux__)
+#include <sys/auxv.h>
+#endif
+#include <atomic>
+#include <charconv>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+namespace {
+
+// FNV-1a over 64-bit words; a cache key, not a checksum
+uint64_t mix(uint64_t hash, const char* data, size_t size) {
+    constexpr uint64_t kPrime = 0x100000001b3ULL;
+    size_t i = 0;
+    for (; i + 8 <= size; i += 8) {
+        uint64_t word;
+        std::memcpy(&word, data + i, 8);
+        hash = (hash ^ word) * kPrime;
+    }
+    for (; i < size; ++i)
+        hash = (hash ^ static_cast<unsigned char>(data[i])) * kPrime;
+    return hash;
+}
+
+uint64_t hashFile(const std::string& path, bool& ok) {
+    std::ifstream in(path, std::ios::binary);
+    std::vector<char> buffer(1 << 20);
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    while (in) {
+        in.read(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+        hash = mix(hash, buffer.data(), static_cast<size_t>(in.gcount()));
+    }
+    ok = in.eof();
+    return hash;
+}
+
+// The extensions MLAS picks kernels and NCHWc block sizes by
+std::string cpuFeatures() {
+#if defined(__x86_64__) || defined(__i386__)
+    std::string features = "x86";
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx")) features += "-avx";
+    if (__builtin_cpu_supports("avx2")) features += "-avx2";
+    if (__builtin_cpu_supports("fma")) features += "-fma";
+    if (__builtin_cpu_supports("avx512f")) features += "-avx512f";
+    if (__builtin_cpu_supports("avx512bw")) features += "-avx512bw";
+    if (__builtin_cpu_supports("avx512vl")) features += "-avx512vl";
+    if (__builtin_cpu_supports("avx512vnni")) features += "-avx512vnni";
+    return features;
+#elif defined(__aarch64__) && defined(__linux__)
+    return "arm64-" + std::to_string(getauxval(AT_HWCAP)) + "-" + std::to_string(getauxval(AT_HWCAP2));
+#else
+    return "generic";
+#endif
+}
+
+Ort::SessionOptions sessionOptions(const SessionSettings& settings) {
+    Ort::SessionOptions options;
+    options.SetIntraOpNumThreads(settings.intraOpThreads);
+    options.SetGraphOptimizationLevel(settings.optimization);
+    for (const std::string& provider : settings.executionProviders)
+        options.AppendExecutionProvider(provider);
+    if (!settings.profilePrefix.empty())
+        options.EnableProfiling(settings.profilePrefix.c_str());
+    return options;
+}
+
+// The settings that change the optimized graph; profiling does not
+std::string settingsKey(const SessionSettings& settings) {
+    std::string key = "opt" + std::to_string(static_cast<int>(settings.optimization)) +
+                      "|threads" + std::to_string(settings.intraOpThreads) + "|ep";
+    for (const std::string& provider : settings.executionProviders)
+        key += "," + provider;
+    return key;
+}
+
+std::string defaultCacheDirectory() {
+    if (const char* configured = std::getenv("FACERECO_MODEL_CACHE"))
+        return configured;
+    if (const char* xdg = std::getenv("XDG_CACHE_HOME"); xdg && *xdg)
+        return std::string(xdg) + "/facereco";
+    if (const char* home = std::getenv("HOME"); home && *home)
+        return std::string(home) + "/.cache/facereco";
+    return {};
+}
+
+// One "<hash> <stamp>" line per model seen, appended as they are hashed
+constexpr const char* kHashIndexName = "hashes.txt";
+
+}  // namespace
+
+OrtRuntime& OrtRuntime::instance() {
+    static OrtRuntime runtime;
+    return runtime;
+}
+
+OrtRuntime::OrtRuntime()
+    : environment(ORT_LOGGING_LEVEL_WARNING, "FaceReco"), cacheDirectory(defaultCacheDirectory()) {
+    Ort::ThrowOnError(Ort::GetApi().CreatePrepackedWeightsContainer(&prepackedWeights));
+}
+
+OrtRuntime::~OrtRuntime() {
+    if (prepackedWeights)
+        Ort::GetApi().ReleasePrepackedWeightsContainer(prepackedWeights);
+}
+
+void OrtRuntime::setModelCacheDirectory(const std::string& path) {
+    std::lock_guard<std::mutex> lock(mutex);
+    cacheDirectory = path;
+}
+
+std::string OrtRuntime::modelCacheDirectory() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return cacheDirectory;
+}
+
+void OrtRuntime::loadHashIndex() {
+    contentHashes.clear();
+    indexedDirectory = cacheDirectory;
+    std::ifstream in(fs::path(cacheDirectory) / kHashIndexName);
+    std::string line;
+    while (std::getline(in, line)) {
+        size_t space = line.find(' ');
+        if (space == std::string::npos || space == 0)
+            continue;
+        uint64_t hash = 0;
+        auto [end, error] = std::from_chars(line.data(), line.data() + space, hash, 16);
+        if (error == std::errc() && end == line.data() + space)
+            contentHashes[line.substr(space + 1)] = hash;
+    }
+}
+
+void OrtRuntime::appendHashIndex(const std::string& stamp, uint64_t hash) {
+    if (stamp.find('\n') != std::string::npos)
+        return;
+    // A single short append per line, so concurrent starts do not interleave
+    std::ostringstream line;
+    line << std::hex << hash << ' ' << stamp << '\n';
+    std::ofstream out(fs::path(cacheDirectory) / kHashIndexName, std::ios::app);
+    out << line.str() << std::flush;
+}
+
+std::string OrtRuntime::cachedModelPath(const std::string& modelPath, const SessionSettings& settings) {
+    std::lock_guard<std::mutex> lock(mutex);
+    // Without optimization there is nothing worth caching
+    if (cacheDirectory.empty() || settings.optimization == GraphOptimizationLevel::ORT_DISABLE_ALL)
+        return {};
+
+    // A missing model is left for ORT to report
+    std::error_code error;
+    auto size = fs::file_size(modelPath, error);
+    if (error)
+        return {};
+    auto modified = fs::last_write_time(modelPath, error);
+    fs::path absolute = fs::absolute(modelPath, error);
+    if (error)
+        return {};
+
+    fs::create_directories(cacheDirectory, error);
+    if (error)
+        return {};
+
+    // Hashed once per cache directory, not once per start, unless the file changes
+    std::string stamp = absolute.string() + "|" + std::to_string(size) + "|" +
+                        std::to_string(modified.time_since_epoch().count());
+    if (indexedDirectory != cacheDirectory)
+        loadHashIndex();
+    auto it = contentHashes.find(stamp);
+    if (it == contentHashes.end()) {
+        bool ok = false;
+        uint64_t hash = hashFile(modelPath, ok);
+        if (!ok)
+            return {};
+        it = contentHashes.emplace(stamp, hash).first;
+        appendHashIndex(stamp, hash);
+    }
+    std::string environmentKey = Ort::GetVersionString() + "|" + cpuFeatures() + "|" + settingsKey(settings);
+    uint64_t hash = mix(it->second, environmentKey.data(), environmentKey.size());
+    std::ostringstream name;
+    name << fs::path(modelPath).stem().string() << "-" << std::hex << hash << ".onnx";
+    return (fs::path(cacheDirectory) / name.str()).string();
+}
+
+Ort::Session OrtRuntime::createSession(const std::string& modelPath, const SessionSettings& settings) {
+    static Counter& hits = MetricsRegistry::instance().counter("model_cache_hits");
+    static Counter& misses = MetricsRegistry::instance().counter("model_cache_misses");
+    static Histogram& loadTime = MetricsRegistry::instance().histogram("model_load_ms");
+    auto start = std::chrono::steady_clock::now();
+    auto recordLoad = [&] {
+        loadTime.record(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+    };
+
+    std::string cached = cachedModelPath(modelPath, settings);
+    if (cached.empty()) {
+        Ort::Session session(environment, modelPath.c_str(), sessionOptions(settings), prepackedWeights);
+        recordLoad();
+        return session;
+    }
+
+    if (fs::exists(cached)) {
+        // Already optimized; running the optimizers over it again only costs time
+        SessionSettings direct = settings;
+        direct.optimization = GraphOptimizationLevel::ORT_DISABLE_ALL;
+        try {
+            Ort::Session session(environment, cached.c_str(), sessionOptions(direct), prepackedWeights);
+            hits.add();
+            recordLoad();
+            return session;
+        } catch (const Ort::Exception& e) {
+            std::cerr << "Ignoring unusable optimized model " << cached << ": " << e.what() << "\n";
+            std::error_code ignored;
+            fs::remove(cached, ignored);
+        }
+    }
+
+    // ORT writes the optimized graph while creating the session. It goes to
+    // a private name first, so concurrent starts never load a partial file.
+    static std::atomic<unsigned> sequence{0};
+    std::string temporary = cached + ".tmp" + std::to_string(::getpid()) + "." + std::to_string(sequence++);
+    Ort::SessionOptions saving = sessionOptions(settings);
+    saving.SetOptimizedModelFilePath(temporary.c_str());
+    std::error_code error;
+    try {
+        Ort::Session session(environment, modelPath.c_str(), saving, prepackedWeights);
+        misses.add();
+        recordLoad();
+        fs::rename(temporary, cached, error);
+        if (error)
+            fs::remove(temporary, error);
+        return session;
+    } catch (const Ort::Exception&) {
+        fs::remove(temporary, error);
+        throw;
+    }
+}
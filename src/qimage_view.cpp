@@ -0,0 +1,41 @@
+#include "qimage_view.hpp"
+
+bool imageViewFor(const QImage& image, ImageView& view) {
+    if (image.isNull())
+        return false;
+
+    switch (image.format()) {
+    case QImage::Format_RGB32:
+    case QImage::Format_ARGB32:
+        // 0xAARRGGBB words, so the byte order depends on the host
+#if Q_BYTE_ORDER == Q_BIG_ENDIAN
+        view.layout = layouts::Argb;
+#else
+        view.layout = layouts::Bgra;
+#endif
+        break;
+    case QImage::Format_RGBX8888:
+    case QImage::Format_RGBA8888:
+        view.layout = layouts::Rgba;
+        break;
+    case QImage::Format_RGB888:
+        view.layout = layouts::Rgb;
+        break;
+#if QT_VERSION >= QT_VERSION_CHECK(5, 14, 0)
+    case QImage::Format_BGR888:
+        view.layout = layouts::Bgr;
+        break;
+#endif
+    case QImage::Format_Grayscale8:
+        view.layout = layouts::Gray;
+        break;
+    default:
+        return false;
+    }
+
+    view.data = image.constBits();
+    view.width = image.width();
+    view.height = image.height();
+    view.stride = static_cast<size_t>(image.bytesPerLine());
+    return true;
+}
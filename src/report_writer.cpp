@@ -0,0 +1,381 @@
+#include "report_writer.hpp"
+#include "thread_pool.hpp"
+#include "metrics.hpp"
+#include "trace.hpp"
+#include <opencv2/opencv.hpp>
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cstdio>
+#include <future>
+#include <sstream>
+
+namespace {
+
+// A4 in PDF points
+constexpr double kPageWidth = 595.0;
+constexpr double kPageHeight = 842.0;
+constexpr double kMargin = 40.0;
+constexpr double kPixelToPoint = 0.75;
+constexpr size_t kMaxTextChars = 100;
+
+std::string pdfString(const std::string& text) {
+    std::string escaped;
+    size_t n = std::min(text.size(), kMaxTextChars);
+    for (size_t i = 0; i < n; ++i) {
+        unsigned char c = static_cast<unsigned char>(text[i]);
+        if (c == '(' || c == ')' || c == '\\') {
+            escaped += '\\';
+            escaped += static_cast<char>(c);
+        } else if (c < 32 || c > 126) {
+            escaped += '?';
+        } else {
+            escaped += static_cast<char>(c);
+        }
+    }
+    if (text.size() > kMaxTextChars)
+        escaped += "...";
+    return escaped;
+}
+
+std::string htmlEscape(const std::string& text) {
+    std::string escaped;
+    escaped.reserve(text.size());
+    for (char c : text) {
+        switch (c) {
+            case '&': escaped += "&amp;"; break;
+            case '<': escaped += "&lt;"; break;
+            case '>': escaped += "&gt;"; break;
+            case '"': escaped += "&quot;"; break;
+            default: escaped += c;
+        }
+    }
+    return escaped;
+}
+
+void writeBase64(std::ostream& out, const std::vector<unsigned char>& bytes) {
+    static const char table[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    char quad[4];
+    size_t i = 0;
+    for (; i + 2 < bytes.size(); i += 3) {
+        unsigned v = (bytes[i] << 16) | (bytes[i + 1] << 8) | bytes[i + 2];
+        quad[0] = table[(v >> 18) & 63];
+        quad[1] = table[(v >> 12) & 63];
+        quad[2] = table[(v >> 6) & 63];
+        quad[3] = table[v & 63];
+        out.write(quad, 4);
+    }
+    if (i < bytes.size()) {
+        unsigned v = bytes[i] << 16;
+        if (i + 1 < bytes.size())
+            v |= bytes[i + 1] << 8;
+        quad[0] = table[(v >> 18) & 63];
+        quad[1] = table[(v >> 12) & 63];
+        quad[2] = i + 1 < bytes.size() ? table[(v >> 6) & 63] : '=';
+        quad[3] = '=';
+        out.write(quad, 4);
+    }
+}
+
+}  // namespace
+
+class ReportWriter::Backend {
+public:
+    explicit Backend(std::ostream& out) : out(out) {}
+    virtual ~Backend() = default;
+    virtual void add(const MatchResult& result, const ReportImage& image) = 0;
+    virtual void finish() = 0;
+
+protected:
+    std::ostream& out;
+};
+
+// Minimal PDF 1.4 writer: one Helvetica font, DCTDecode image XObjects and a
+// content stream per page. Objects 1-3 (catalog, page tree, font) are
+// reserved up front and written last, everything else as soon as it exists.
+class ReportWriter::PdfBackend : public ReportWriter::Backend {
+public:
+    explicit PdfBackend(std::ostream& out) : Backend(out), offsets(3, 0) {
+        out << "%PDF-1.4\n%\xE2\xE3\xCF\xD3\n";
+        cursorY = kPageHeight - kMargin;
+    }
+
+    void add(const MatchResult& result, const ReportImage& image) override {
+        double imageWidth = image.width * kPixelToPoint;
+        double imageHeight = image.height * kPixelToPoint;
+        double maxWidth = kPageWidth - 2 * kMargin;
+        if (imageWidth > maxWidth) {
+            imageHeight *= maxWidth / imageWidth;
+            imageWidth = maxWidth;
+        }
+        double blockHeight = (image.jpeg.empty() ? 0.0 : imageHeight + 10.0) + 40.0;
+
+        if (cursorY - blockHeight < kMargin && pageDirty)
+            flushPage();
+
+        if (!image.jpeg.empty()) {
+            int imageObj = writeImage(image);
+            pageImages.push_back(imageObj);
+            cursorY -= imageHeight;
+            content << "q " << imageWidth << " 0 0 " << imageHeight << ' '
+                    << kMargin << ' ' << cursorY << " cm /Im" << imageObj << " Do Q\n";
+            cursorY -= 10.0;
+        }
+
+        cursorY -= 12.0;
+        content << "BT /F1 10 Tf " << kMargin << ' ' << cursorY
+                << " Td (URL: " << pdfString(result.url) << ") Tj ET\n";
+        cursorY -= 14.0;
+        content << "BT /F1 10 Tf " << kMargin << ' ' << cursorY
+                << " Td (Similarity: " << result.similarity << ") Tj ET\n";
+        cursorY -= 14.0;
+        pageDirty = true;
+    }
+
+    void finish() override {
+        if (pageDirty || pageObjs.empty())
+            flushPage();
+
+        beginObject(3);
+        out << "<< /Type /Font /Subtype /Type1 /BaseFont /Helvetica /Encoding /WinAnsiEncoding >>\nendobj\n";
+
+        beginObject(2);
+        out << "<< /Type /Pages /Count " << pageObjs.size() << " /Kids [";
+        for (int page : pageObjs)
+            out << ' ' << page << " 0 R";
+        out << " ] >>\nendobj\n";
+
+        beginObject(1);
+        out << "<< /Type /Catalog /Pages 2 0 R >>\nendobj\n";
+
+        std::streamoff xref = out.tellp();
+        out << "xref\n0 " << offsets.size() + 1 << "\n0000000000 65535 f \n";
+        char line[32];
+        for (std::streamoff offset : offsets) {
+            std::snprintf(line, sizeof(line), "%010lld 00000 n \n", static_cast<long long>(offset));
+            out << line;
+        }
+        out << "trailer\n<< /Size " << offsets.size() + 1 << " /Root 1 0 R >>\nstartxref\n"
+            << xref << "\n%%EOF\n";
+    }
+
+private:
+    int newObject() {
+        offsets.push_back(0);
+        return static_cast<int>(offsets.size());
+    }
+
+    void beginObject(int obj) {
+        offsets[obj - 1] = out.tellp();
+        out << obj << " 0 obj\n";
+    }
+
+    int writeImage(const ReportImage& image) {
+        int obj = newObject();
+        beginObject(obj);
+        out << "<< /Type /XObject /Subtype /Image /Width " << image.width
+            << " /Height " << image.height
+            << " /ColorSpace " << (image.components == 1 ? "/DeviceGray" : "/DeviceRGB")
+            << " /BitsPerComponent 8 /Filter /DCTDecode /Length " << image.jpeg.size()
+            << " >>\nstream\n";
+        out.write(reinterpret_cast<const char*>(image.jpeg.data()), image.jpeg.size());
+        out << "\nendstream\nendobj\n";
+        return obj;
+    }
+
+    void flushPage() {
+        std::string stream = content.str();
+        int contentObj = newObject();
+        beginObject(contentObj);
+        out << "<< /Length " << stream.size() << " >>\nstream\n" << stream << "\nendstream\nendobj\n";
+
+        int pageObj = newObject();
+        beginObject(pageObj);
+        out << "<< /Type /Page /Parent 2 0 R /MediaBox [0 0 " << kPageWidth << ' ' << kPageHeight
+            << "] /Resources << /Font << /F1 3 0 R >> /XObject <<";
+        for (int image : pageImages)
+            out << " /Im" << image << ' ' << image << " 0 R";
+        out << " >> >> /Contents " << contentObj << " 0 R >>\nendobj\n";
+        pageObjs.push_back(pageObj);
+
+        content.str("");
+        content.clear();
+        pageImages.clear();
+        cursorY = kPageHeight - kMargin;
+        pageDirty = false;
+    }
+
+    std::vector<std::streamoff> offsets;
+    std::vector<int> pageObjs;
+    std::vector<int> pageImages;
+    std::ostringstream content;
+    double cursorY;
+    bool pageDirty = false;
+};
+
+class ReportWriter::HtmlBackend : public ReportWriter::Backend {
+public:
+    explicit HtmlBackend(std::ostream& out) : Backend(out) {
+        out << "<!DOCTYPE html>\n<html><head><meta charset=\"utf-8\"><title>FaceReco results</title>\n"
+            << "<style>body{font-family:sans-serif}figure{display:inline-block;margin:8px;"
+            << "vertical-align:top;max-width:320px;word-break:break-all}</style></head><body>\n";
+    }
+
+    void add(const MatchResult& result, const ReportImage& image) override {
+        std::string url = htmlEscape(result.url);
+        out << "<figure>";
+        if (!image.jpeg.empty()) {
+            out << "<img width=\"" << image.width << "\" height=\"" << image.height
+                << "\" src=\"data:image/jpeg;base64,";
+            writeBase64(out, image.jpeg);
+            out << "\">";
+        }
+        out << "<figcaption><a href=\"" << url << "\">" << url << "</a><br>Similarity: "
+            << result.similarity << "</figcaption></figure>\n";
+    }
+
+    void finish() override {
+        out << "</body></html>\n";
+    }
+};
+
+ReportWriter::ReportWriter(const std::string& path)
+    : ReportWriter(path, formatForPath(path)) {}
+
+ReportWriter::ReportWriter(const std::string& path, Format format)
+    : out(path, std::ios::binary | std::ios::trunc) {
+    if (!out.is_open())
+        return;
+    if (format == Format::Html)
+        backend = std::make_unique<HtmlBackend>(out);
+    else
+        backend = std::make_unique<PdfBackend>(out);
+}
+
+ReportWriter::~ReportWriter() {
+    finish();
+}
+
+bool ReportWriter::isOpen() const {
+    return backend != nullptr;
+}
+
+void ReportWriter::add(const MatchResult& result, const ReportImage& image) {
+    if (backend && !finished)
+        backend->add(result, image);
+}
+
+bool ReportWriter::finish() {
+    if (!backend)
+        return false;
+    if (!finished) {
+        backend->finish();
+        out.flush();
+        finished = true;
+    }
+    return out.good();
+}
+
+ReportWriter::Format ReportWriter::formatForPath(const std::string& path) {
+    size_t dot = path.find_last_of('.');
+    std::string ext = dot == std::string::npos ? std::string() : path.substr(dot);
+    std::transform(ext.begin(), ext.end(), ext.begin(), [](unsigned char c) { return std::tolower(c); });
+    return (ext == ".html" || ext == ".htm") ? Format::Html : Format::Pdf;
+}
+
+bool ReportWriter::probeJpeg(const std::vector<unsigned char>& bytes, int& width, int& height, int& components) {
+    if (bytes.size() < 4 || bytes[0] != 0xFF || bytes[1] != 0xD8)
+        return false;
+
+    size_t pos = 2;
+    while (pos + 4 <= bytes.size()) {
+        if (bytes[pos] != 0xFF)
+            return false;
+        unsigned char marker = bytes[pos + 1];
+        if (marker == 0xFF) {  // fill byte
+            ++pos;
+            continue;
+        }
+        if (marker == 0x01 || (marker >= 0xD0 && marker <= 0xD8)) {
+            pos += 2;
+            continue;
+        }
+        size_t length = (bytes[pos + 2] << 8) | bytes[pos + 3];
+        bool isFrame = marker >= 0xC0 && marker <= 0xCF &&
+                       marker != 0xC4 && marker != 0xC8 && marker != 0xCC;
+        if (isFrame) {
+            if (pos + 10 > bytes.size())
+                return false;
+            height = (bytes[pos + 5] << 8) | bytes[pos + 6];
+            width = (bytes[pos + 7] << 8) | bytes[pos + 8];
+            components = bytes[pos + 9];
+            return width > 0 && height > 0;
+        }
+        pos += 2 + length;
+    }
+    return false;
+}
+
+ReportImage ReportWriter::prepareImage(const std::vector<unsigned char>& bytes, int width) {
+    ReportImage image;
+    if (bytes.empty())
+        return image;
+
+    int w = 0, h = 0, components = 0;
+    if (probeJpeg(bytes, w, h, components) && w <= width && (components == 1 || components == 3)) {
+        image.jpeg = bytes;
+        image.width = w;
+        image.height = h;
+        image.components = components;
+        return image;
+    }
+
+    cv::Mat decoded = cv::imdecode(bytes, cv::IMREAD_COLOR);
+    if (decoded.empty())
+        return image;
+    if (decoded.cols > width) {
+        int height = std::max(1, decoded.rows * width / decoded.cols);
+        cv::resize(decoded, decoded, cv::Size(width, height), 0, 0, cv::INTER_AREA);
+    }
+    cv::imencode(".jpg", decoded, image.jpeg, {cv::IMWRITE_JPEG_QUALITY, 85});
+    image.width = decoded.cols;
+    image.height = decoded.rows;
+    image.components = 3;
+    return image;
+}
+
+bool writeReport(const std::vector<MatchResult>& results, const std::string& path,
+                 const ReportProgress& progress, int thumbnailWidth) {
+    static Histogram& reportTime = MetricsRegistry::instance().histogram("report_ms");
+    TraceSpan span("report", "report");
+    span.setItems(static_cast<int64_t>(results.size()));
+    auto started = std::chrono::steady_clock::now();
+    ReportWriter writer(path);
+    if (!writer.isOpen())
+        return false;
+
+    ThreadPool pool;
+    const size_t window = pool.size() * 4;
+
+    // Only one window of prepared thumbnails is alive at a time
+    for (size_t start = 0; start < results.size(); start += window) {
+        size_t end = std::min(results.size(), start + window);
+        std::vector<std::future<ReportImage>> prepared;
+        prepared.reserve(end - start);
+        for (size_t i = start; i < end; ++i) {
+            const auto& thumbnail = results[i].thumbnail;
+            prepared.push_back(pool.submit([&thumbnail, thumbnailWidth] {
+                return ReportWriter::prepareImage(thumbnail, thumbnailWidth);
+            }));
+        }
+        for (size_t i = start; i < end; ++i) {
+            writer.add(results[i], prepared[i - start].get());
+            if (progress)
+                progress(i + 1, results.size());
+        }
+    }
+
+    bool written = writer.finish();
+    reportTime.record(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - started).count());
+    return written;
+}
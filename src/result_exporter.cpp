@@ -0,0 +1,139 @@
+#include "result_exporter.hpp"
+#include <nlohmann/json.hpp>
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <cmath>
+
+using json = nlohmann::json;
+
+namespace {
+
+constexpr size_t kBufferSize = 64 * 1024;
+
+void appendCsvField(std::string& row, const std::string& field) {
+    if (field.find_first_of(",\"\r\n") == std::string::npos) {
+        row += field;
+        return;
+    }
+    row += '"';
+    for (char c : field) {
+        if (c == '"')
+            row += '"';
+        row += c;
+    }
+    row += '"';
+}
+
+// std::to_string follows the C locale, which may use a decimal comma and
+// break the CSV columns; to_chars always writes '.'
+void appendCsvNumber(std::string& row, int value) {
+    char digits[16];
+    auto end = std::to_chars(digits, digits + sizeof(digits), value).ptr;
+    row += ',';
+    row.append(digits, end);
+}
+
+void appendCsvNumber(std::string& row, double value) {
+    char digits[64];
+    auto [end, error] = std::to_chars(digits, digits + sizeof(digits), value, std::chars_format::fixed, 6);
+    row += ',';
+    if (error == std::errc())
+        row.append(digits, end);
+}
+
+// Keeps float noise such as 0.8999999761 out of the JSON output
+double rounded(double value) {
+    return std::round(value * 1e6) / 1e6;
+}
+
+}  // namespace
+
+ResultExporter::ResultExporter(const std::string& path)
+    : ResultExporter(path, formatForPath(path)) {}
+
+ResultExporter::ResultExporter(const std::string& path, Format format) : format(format) {
+    if (path == "-") {
+        file = stdout;
+    } else {
+        file = std::fopen(path.c_str(), "wb");
+        ownsFile = true;
+    }
+    buffer.reserve(kBufferSize);
+
+    if (file && format == Format::Csv)
+        buffer += "url,similarity,box_x,box_y,box_width,box_height,download_ms,decode_ms,inference_ms,source\n";
+}
+
+ResultExporter::~ResultExporter() {
+    flush();
+    if (file && ownsFile)
+        std::fclose(file);
+}
+
+bool ResultExporter::isOpen() const {
+    return file != nullptr;
+}
+
+void ResultExporter::write(const MatchResult& result) {
+    std::string row;
+    if (format == Format::Csv) {
+        appendCsvField(row, result.url);
+        appendCsvNumber(row, static_cast<double>(result.similarity));
+        appendCsvNumber(row, result.boxX);
+        appendCsvNumber(row, result.boxY);
+        appendCsvNumber(row, result.boxWidth);
+        appendCsvNumber(row, result.boxHeight);
+        appendCsvNumber(row, result.downloadMs);
+        appendCsvNumber(row, result.decodeMs);
+        appendCsvNumber(row, result.inferenceMs);
+        row += ',';
+        appendCsvField(row, result.source);
+        row += '\n';
+    } else {
+        json record = {
+            {"url", result.url},
+            {"similarity", rounded(result.similarity)},
+            {"box", {result.boxX, result.boxY, result.boxWidth, result.boxHeight}},
+            {"timings_ms", {
+                {"download", rounded(result.downloadMs)},
+                {"decode", rounded(result.decodeMs)},
+                {"inference", rounded(result.inferenceMs)}}},
+            {"source", result.source},
+        };
+        row = record.dump(-1, ' ', false, json::error_handler_t::replace);
+        row += '\n';
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!file)
+        return;
+    buffer += row;
+    if (buffer.size() >= kBufferSize)
+        writeBuffer();
+}
+
+bool ResultExporter::flush() {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!file)
+        return false;
+    writeBuffer();
+    if (std::fflush(file) != 0)
+        failed = true;
+    return !failed;
+}
+
+void ResultExporter::writeBuffer() {
+    if (buffer.empty())
+        return;
+    if (std::fwrite(buffer.data(), 1, buffer.size(), file) != buffer.size())
+        failed = true;
+    buffer.clear();
+}
+
+ResultExporter::Format ResultExporter::formatForPath(const std::string& path) {
+    size_t dot = path.find_last_of('.');
+    std::string ext = dot == std::string::npos ? std::string() : path.substr(dot);
+    std::transform(ext.begin(), ext.end(), ext.begin(), [](unsigned char c) { return std::tolower(c); });
+    return ext == ".csv" ? Format::Csv : Format::JsonLines;
+}
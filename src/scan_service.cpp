@@ -0,0 +1,101 @@
+#include "scan_service.hpp"
+#include "crawler.hpp"
+#include "metrics.hpp"
+#include "trace.hpp"
+
+ScanService::ScanService(QObject* parent) : ScanService(ScanOptions{}, parent) {}
+
+ScanService::ScanService(const ScanOptions& options, QObject* parent)
+    : QObject(parent), depth(MetricsRegistry::instance().gauge("scan_queue_depth")) {
+    http.setTimeouts(options.connectTimeout, options.requestTimeout);
+    worker = std::thread([this] { workerLoop(); });
+}
+
+ScanService::~ScanService() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+        cancelLocked();
+    }
+    ready.notify_all();
+    worker.join();
+}
+
+int ScanService::submit(const QString& imagePath, std::vector<float> referenceEmbedding) {
+    std::vector<int> dropped;
+    int id;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        dropped = cancelLocked();
+        id = ++nextId;
+        pending.push_back({id, imagePath, std::move(referenceEmbedding)});
+        depth.set(static_cast<int64_t>(pending.size()));
+    }
+    ready.notify_one();
+    for (int job : dropped)
+        emit jobFinished(job, {}, true);
+    return id;
+}
+
+void ScanService::cancel() {
+    std::vector<int> dropped;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        dropped = cancelLocked();
+    }
+    for (int job : dropped)
+        emit jobFinished(job, {}, true);
+}
+
+std::vector<int> ScanService::cancelLocked() {
+    std::vector<int> dropped;
+    for (const Job& job : pending)
+        dropped.push_back(job.id);
+    pending.clear();
+    depth.set(0);
+    if (running)
+        running->stopSearch();
+    return dropped;
+}
+
+void ScanService::workerLoop() {
+    Tracer::instance().nameThread("scan");
+    for (;;) {
+        Job job;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            ready.wait(lock, [this] { return stopping || !pending.empty(); });
+            if (stopping)
+                return;
+            job = std::move(pending.front());
+            pending.pop_front();
+            depth.set(static_cast<int64_t>(pending.size()));
+        }
+
+        Crawler crawler(job.imagePath.toStdString());
+        crawler.setHttpClient(&http);
+        crawler.setReferenceEmbedding(std::move(job.referenceEmbedding));
+        const int id = job.id;
+        crawler.setMatchCallback([this, id](const MatchResult& match) { emit matchFound(id, match); });
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            running = &crawler;
+            // Superseded between being taken off the queue and starting
+            if (stopping || !pending.empty())
+                crawler.stopSearch();
+        }
+
+        emit jobStarted(id);
+        if (!crawler.stopped())
+            crawler.startSearch();
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            running = nullptr;
+        }
+
+        std::vector<MatchResult> matches = crawler.getMatchedImages();
+        emit jobFinished(id, QVector<MatchResult>(matches.begin(), matches.end()), crawler.stopped());
+    }
+}
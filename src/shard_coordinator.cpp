@@ -0,0 +1,198 @@
+#include "shard_coordinator.hpp"
+#include "gallery.hpp"
+#include "match_server.hpp"
+#include "onnx_face_compare.hpp"
+#include <opencv2/imgcodecs.hpp>
+#include <condition_variable>
+#include <queue>
+#include <stdexcept>
+#include <tuple>
+
+using json = nlohmann::json;
+
+struct ShardCoordinator::Shard {
+    std::string socketPath;
+    std::mutex mutex;
+    std::vector<std::unique_ptr<MatchClient>> idle;
+};
+
+namespace {
+
+std::vector<float> embedImage(FaceEmbeddingExtractor& extractor, const std::string& path) {
+    cv::Mat img = cv::imread(path, cv::IMREAD_COLOR);
+    if (img.empty())
+        throw std::runtime_error("cannot read image: " + path);
+    return extractor.getEmbedding(img);
+}
+
+}  // namespace
+
+ShardCoordinator::ShardCoordinator(FaceEmbeddingExtractor& extractor, std::vector<std::string> shardSockets,
+                                   std::chrono::milliseconds defaultDeadline)
+    : extractor(extractor), defaultDeadline(defaultDeadline), pool(std::max<size_t>(1, shardSockets.size() * 4)) {
+    if (shardSockets.empty())
+        throw std::invalid_argument("ShardCoordinator needs at least one shard");
+    for (auto& socketPath : shardSockets) {
+        auto shard = std::make_unique<Shard>();
+        shard->socketPath = std::move(socketPath);
+        shards.push_back(std::move(shard));
+    }
+}
+
+ShardCoordinator::~ShardCoordinator() = default;
+
+json ShardCoordinator::callShard(Shard& shard, const json& request, std::chrono::steady_clock::time_point deadline) {
+    using Clock = std::chrono::steady_clock;
+    auto remaining = [&] {
+        if (deadline == Clock::time_point::max())
+            return std::chrono::milliseconds::max();
+        return std::max(std::chrono::milliseconds(0),
+                        std::chrono::duration_cast<std::chrono::milliseconds>(deadline - Clock::now()));
+    };
+
+    std::unique_ptr<MatchClient> client;
+    {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        if (!shard.idle.empty()) {
+            client = std::move(shard.idle.back());
+            shard.idle.pop_back();
+        }
+    }
+
+    // A pooled connection may be stale if the shard restarted; retry once on
+    // a fresh one while there is time left. A connection that timed out is
+    // closed by call() and never goes back to the pool.
+    json response;
+    if (!client || !client->call(request, response, remaining())) {
+        if (remaining().count() == 0)
+            return {{"error", "shard timed out: " + shard.socketPath}};
+        client = std::make_unique<MatchClient>();
+        if (!client->connect(shard.socketPath))
+            return {{"error", "cannot connect to shard: " + shard.socketPath}};
+        if (!client->call(request, response, remaining()))
+            return {{"error", "shard connection lost: " + shard.socketPath}};
+    }
+
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    shard.idle.push_back(std::move(client));
+    return response;
+}
+
+json ShardCoordinator::query(json request) {
+    using Clock = std::chrono::steady_clock;
+    auto budget = std::chrono::milliseconds(request.value("deadline_ms", static_cast<int64_t>(defaultDeadline.count())));
+    auto deadline = Clock::now() + budget;
+
+    if (!request.contains("embedding")) {
+        request["embedding"] = embedImage(extractor, request.at("image").get<std::string>());
+        request.erase("image");
+    }
+    size_t topK = request.value("top_k", size_t(5));
+
+    // Shards drop the work themselves if it is still queued past the deadline
+    if (budget.count() > 0) {
+        auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - Clock::now());
+        request["deadline_ms"] = std::max<int64_t>(1, remaining.count());
+    }
+
+    struct Gather {
+        std::mutex mutex;
+        std::condition_variable done;
+        std::vector<json> replies;
+        size_t answered = 0;
+    };
+    auto gather = std::make_shared<Gather>();
+    gather->replies.resize(shards.size());
+
+    for (size_t i = 0; i < shards.size(); ++i) {
+        auto shardDeadline = budget.count() > 0 ? deadline : Clock::time_point::max();
+        pool.submit([this, gather, i, request, shardDeadline] {
+            json reply = callShard(*shards[i], request, shardDeadline);
+            std::lock_guard<std::mutex> lock(gather->mutex);
+            gather->replies[i] = std::move(reply);
+            ++gather->answered;
+            gather->done.notify_all();
+        });
+    }
+
+    std::vector<json> replies;
+    {
+        std::unique_lock<std::mutex> lock(gather->mutex);
+        auto allAnswered = [&] { return gather->answered == shards.size(); };
+        if (budget.count() > 0)
+            gather->done.wait_until(lock, deadline, allAnswered);
+        else
+            gather->done.wait(lock, allAnswered);
+        replies = gather->replies;
+    }
+
+    // Each shard's list is already sorted; merge them through a max-heap
+    using Cursor = std::tuple<float, size_t, size_t>;  // score, shard, position
+    std::priority_queue<Cursor> heads;
+    size_t responded = 0;
+    for (size_t i = 0; i < replies.size(); ++i) {
+        const json& reply = replies[i];
+        if (!reply.is_object() || !reply.contains("matches"))
+            continue;
+        ++responded;
+        if (!reply["matches"].empty())
+            heads.emplace(reply["matches"][0].value("score", 0.0f), i, 0);
+    }
+
+    json matches = json::array();
+    while (!heads.empty() && matches.size() < topK) {
+        auto [score, shard, position] = heads.top();
+        heads.pop();
+        const json& list = replies[shard]["matches"];
+        matches.push_back(list[position]);
+        if (position + 1 < list.size())
+            heads.emplace(list[position + 1].value("score", 0.0f), shard, position + 1);
+    }
+
+    return {
+        {"matches", std::move(matches)},
+        {"shards", shards.size()},
+        {"responded", responded},
+        {"partial", responded < shards.size()},
+    };
+}
+
+json ShardCoordinator::handle(const json& request) {
+    try {
+        std::string op = request.at("op").get<std::string>();
+
+        if (op == "query")
+            return query(request);
+
+        if (op == "enroll") {
+            if (shards.empty())
+                throw std::runtime_error("no shards to enroll into");
+            json forwarded = request;
+            std::string id = request.at("id").get<std::string>();
+            if (!forwarded.contains("embedding")) {
+                forwarded["embedding"] = embedImage(extractor, request.at("image").get<std::string>());
+                forwarded.erase("image");
+            }
+            return callShard(*shards[Gallery::shardFor(id, shards.size())], forwarded,
+                             std::chrono::steady_clock::time_point::max());
+        }
+
+        if (op == "embed")
+            return {{"embedding", embedImage(extractor, request.at("image").get<std::string>())}};
+
+        if (op == "verify") {
+            auto a = request.contains("embedding") ? request["embedding"].get<std::vector<float>>()
+                                                   : embedImage(extractor, request.at("image").get<std::string>());
+            auto b = request.contains("embedding2") ? request["embedding2"].get<std::vector<float>>()
+                                                    : embedImage(extractor, request.at("image2").get<std::string>());
+            return {{"score", extractor.compareEmbeddings(a, b)}};
+        }
+
+        if (op == "ping")
+            return {{"ok", true}, {"shards", shards.size()}};
+
+        throw std::runtime_error("unknown op: " + op);
+    } catch (const std::exception& e) {
+        return {{"error", e.what()}};
+    }
+}
@@ -0,0 +1,50 @@
+#include "stream_manager.hpp"
+#include <iostream>
+#include <thread>
+
+StreamManager::StreamManager(FaceEmbeddingExtractor& extractor, const Gallery& gallery, StreamManagerOptions options)
+    : extractor(extractor), gallery(gallery), options(options), queue(extractor, options.queue) {}
+
+bool StreamManager::addStream(const StreamConfig& config) {
+    auto stream = std::make_unique<Stream>();
+    stream->config = config;
+    if (!stream->source.open(config.source))
+        return false;
+    stream->source.setPaced(options.paced);
+    stream->detector = std::make_unique<FaceDetector>(options.cascadePath);
+    stream->pipeline = std::make_unique<VideoPipeline>(extractor, gallery, options.video);
+    stream->pipeline->setEmbeddingQueue(&queue, queue.addStream(config.priority));
+    streams.push_back(std::move(stream));
+    return true;
+}
+
+std::vector<VideoStats> StreamManager::run(const FrameCallback& onFrame) {
+    std::vector<VideoStats> stats(streams.size());
+    std::vector<std::thread> threads;
+    threads.reserve(streams.size());
+
+    for (size_t i = 0; i < streams.size(); ++i) {
+        threads.emplace_back([this, i, &stats, &onFrame] {
+            Stream& stream = *streams[i];
+            try {
+                stats[i] = stream.pipeline->run(stream.source, *stream.detector, [&](const FrameResult& frame) {
+                    if (!onFrame)
+                        return;
+                    std::lock_guard<std::mutex> lock(callbackMutex);
+                    onFrame(i, frame);
+                });
+            } catch (const std::exception& e) {
+                std::cerr << "Stream " << stream.config.source << " stopped: " << e.what() << "\n";
+            }
+        });
+    }
+
+    for (std::thread& thread : threads)
+        thread.join();
+    return stats;
+}
+
+void StreamManager::stop() {
+    for (const auto& stream : streams)
+        stream->pipeline->stop();
+}
@@ -0,0 +1,152 @@
+#include "trace.hpp"
+#include <nlohmann/json.hpp>
+#include <unistd.h>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+
+using json = nlohmann::json;
+
+namespace {
+
+// Bounds memory if tracing is left on; later spans are dropped
+constexpr size_t kMaxEvents = 4 * 1024 * 1024;
+
+thread_local uint64_t currentCorrelation = 0;
+
+uint64_t wallMicros() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+               std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+}  // namespace
+
+Tracer& Tracer::instance() {
+    static Tracer tracer;
+    return tracer;
+}
+
+uint32_t Tracer::threadId() {
+    static std::atomic<uint32_t> nextThread{1};
+    thread_local uint32_t id = nextThread.fetch_add(1, std::memory_order_relaxed);
+    return id;
+}
+
+void Tracer::start(const std::string& path, bool profileOrt) {
+    std::lock_guard<std::mutex> lock(mutex);
+    outputPath = path;
+    this->profileOrt = profileOrt;
+    events.clear();
+    ortProfiles.clear();
+    epoch = std::chrono::steady_clock::now();
+    epochWallUs = wallMicros();
+    active = true;
+}
+
+uint64_t Tracer::nowUs() const {
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - epoch).count();
+}
+
+void Tracer::record(const TraceEvent& event) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (active && events.size() < kMaxEvents)
+        events.push_back(event);
+}
+
+void Tracer::nameThread(const std::string& name) {
+    std::lock_guard<std::mutex> lock(mutex);
+    threadNames.emplace_back(threadId(), name);
+}
+
+void Tracer::addOrtProfile(const std::string& path, uint64_t startNs) {
+    std::lock_guard<std::mutex> lock(mutex);
+    ortProfiles.push_back({path, startNs});
+}
+
+bool Tracer::stop() {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!active)
+        return true;
+    active = false;
+
+    const int pid = static_cast<int>(::getpid());
+    json trace = json::array();
+    for (const auto& [thread, name] : threadNames)
+        trace.push_back({{"name", "thread_name"}, {"ph", "M"}, {"pid", pid}, {"tid", thread}, {"args", {{"name", name}}}});
+
+    for (const TraceEvent& event : events) {
+        json entry = {
+            {"name", event.name}, {"cat", event.category}, {"ph", "X"},
+            {"ts", event.startUs}, {"dur", event.durationUs},
+            {"pid", pid}, {"tid", event.thread},
+        };
+        if (event.correlation)
+            entry["args"]["correlation"] = event.correlation;
+        if (event.items >= 0)
+            entry["args"]["items"] = event.items;
+        trace.push_back(std::move(entry));
+    }
+
+    // ORT timestamps are relative to the session's profiling start on the
+    // wall clock; shift them onto this trace's time base
+    for (const OrtProfile& profile : ortProfiles) {
+        std::ifstream in(profile.path);
+        json ortEvents = json::parse(in, nullptr, false);
+        if (!ortEvents.is_array()) {
+            std::cerr << "Cannot read ORT profile: " << profile.path << "\n";
+            continue;
+        }
+        int64_t offset = static_cast<int64_t>(profile.startNs / 1000) - static_cast<int64_t>(epochWallUs);
+        for (json& event : ortEvents) {
+            if (!event.contains("ts"))
+                continue;
+            event["ts"] = event["ts"].get<int64_t>() + offset;
+            event["pid"] = pid;
+            event["cat"] = "ort." + event.value("cat", std::string("Node"));
+            trace.push_back(std::move(event));
+        }
+        std::remove(profile.path.c_str());
+    }
+
+    std::ofstream out(outputPath);
+    out << json{{"traceEvents", std::move(trace)}, {"displayTimeUnit", "ms"}}.dump();
+    events.clear();
+    events.shrink_to_fit();
+    ortProfiles.clear();
+    if (!out) {
+        std::cerr << "Cannot write trace: " << outputPath << "\n";
+        return false;
+    }
+    return true;
+}
+
+TraceSpan::TraceSpan(const char* name, const char* category, uint64_t correlation)
+    : name(name), category(category), active(Tracer::instance().enabled()) {
+    if (!active)
+        return;
+    outer = currentCorrelation;
+    this->correlation = correlation ? correlation : outer;
+    currentCorrelation = this->correlation;
+    startUs = Tracer::instance().nowUs();
+}
+
+TraceSpan::~TraceSpan() {
+    if (!active)
+        return;
+    Tracer& tracer = Tracer::instance();
+    TraceEvent event;
+    event.name = name;
+    event.category = category;
+    event.startUs = startUs;
+    event.durationUs = tracer.nowUs() - startUs;
+    event.thread = Tracer::threadId();
+    event.correlation = correlation;
+    event.items = items;
+    tracer.record(event);
+    currentCorrelation = outer;
+}
+
+uint64_t newCorrelationId() {
+    static std::atomic<uint64_t> next{1};
+    return next.fetch_add(1, std::memory_order_relaxed);
+}
@@ -0,0 +1,196 @@
+#include "video_pipeline.hpp"
+#include "frame_ring.hpp"
+#include "trace.hpp"
+#include <algorithm>
+#include <chrono>
+#include <thread>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+double msSince(Clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+}  // namespace
+
+VideoPipeline::VideoPipeline(FaceEmbeddingExtractor& extractor, const Gallery& gallery, VideoOptions options)
+    : extractor(extractor), gallery(gallery), options(options), tracker(options.tracker), gate(options.motion),
+      scorer(options.quality) {}
+
+VideoStats VideoPipeline::run(VideoSource& source, FaceDetector& detector, const FrameCallback& onFrame) {
+    stopping = false;
+    tracker.reset();
+    gate.reset();
+    lastFaces.clear();
+    FrameRing<VideoFrame> ring(options.ringCapacity);
+    bool dropFrames = options.dropFrames || source.isLive();
+
+    std::atomic<uint64_t> captured{0};
+    std::thread capture([&] {
+        Tracer::instance().nameThread("capture " + source.name());
+        VideoFrame frame;
+        while (!stopping && source.read(frame)) {
+            ++captured;
+            if (dropFrames)
+                ring.push(std::move(frame));
+            else
+                ring.pushBlocking(std::move(frame));
+            frame = VideoFrame();
+        }
+        ring.close();
+    });
+
+    VideoStats stats;
+    double totalLatency = 0.0;
+    try {
+        while (!stopping) {
+            auto frame = dropFrames ? ring.popLatest() : ring.popOldest();
+            if (!frame)
+                break;
+            FrameResult result = process(*frame, detector);
+            ++stats.processed;
+            stats.skipped += result.skipped;
+            stats.lowQuality += result.lowQuality;
+            stats.faces += result.faces.size();
+            stats.embeddings += result.embeddings;
+            totalLatency += result.latencyMs;
+            stats.maxLatencyMs = std::max(stats.maxLatencyMs, result.latencyMs);
+            if (onFrame)
+                onFrame(result);
+        }
+    } catch (...) {
+        stopping = true;
+        ring.close();
+        capture.join();
+        throw;
+    }
+
+    // Unblocks a capture thread waiting for space after stop()
+    ring.close();
+    capture.join();
+
+    stats.captured = captured;
+    stats.dropped = ring.dropped();
+    if (stats.processed)
+        stats.meanLatencyMs = totalLatency / stats.processed;
+    return stats;
+}
+
+FrameResult VideoPipeline::process(const VideoFrame& frame, FaceDetector& detector) {
+    FrameResult result;
+    result.frameIndex = frame.index;
+    result.streamMs = frame.streamMs;
+    TraceSpan frameSpan("frame", "video", newCorrelationId());
+
+    if (options.motionGating) {
+        bool active = gate.admit(frame.image);
+        result.activity = gate.activity();
+        if (!active) {
+            result.skipped = true;
+            result.faces = lastFaces;
+            for (FaceObservation& face : result.faces)
+                face.embedded = false;
+            result.latencyMs = msSince(frame.captured);
+            return result;
+        }
+    }
+
+    auto start = Clock::now();
+    std::vector<cv::Rect> boxes;
+    {
+        TraceSpan span("detect", "video");
+        boxes = detector.detect(frame.image);
+    }
+    result.detectMs = msSince(start);
+
+    std::vector<int> trackIds;
+    if (options.tracking)
+        trackIds = tracker.update(boxes);
+
+    // Collect the faces that need an embedding so they are inferred together
+    std::vector<size_t> toEmbed;
+    std::vector<float> qualities;
+    std::vector<cv::Mat> crops;
+    const cv::Rect bounds(0, 0, frame.image.cols, frame.image.rows);
+    for (size_t i = 0; i < boxes.size(); ++i) {
+        FaceObservation face;
+        face.box = boxes[i];
+        if (options.tracking)
+            face.trackId = trackIds[i];
+
+        cv::Rect crop = FaceDetector::expand(face.box, frame.image.size());
+        if (crop.area() == 0)
+            continue;
+
+        FaceQuality quality = scorer.assess(frame.image(face.box & bounds));
+        face.quality = quality.score;
+        face.verdict = quality.verdict;
+        bool usable = !options.qualityGate || quality.acceptable();
+        if (usable && (!options.tracking || tracker.wantsEmbedding(face.trackId, quality.score))) {
+            face.embedded = true;
+            toEmbed.push_back(result.faces.size());
+            qualities.push_back(quality.score);
+            crops.push_back(frame.image(crop));
+        }
+        if (!usable)
+            ++result.lowQuality;
+        result.faces.push_back(std::move(face));
+    }
+
+    start = Clock::now();
+    std::vector<std::vector<float>> embeddings;
+    if (!crops.empty()) {
+        TraceSpan span("embed", "video");
+        span.setItems(static_cast<int64_t>(crops.size()));
+        if (embeddingQueue) {
+            std::vector<std::future<std::vector<float>>> pending;
+            pending.reserve(crops.size());
+            for (cv::Mat& crop : crops)
+                pending.push_back(embeddingQueue->submit(queueStream, crop));
+            for (auto& future : pending)
+                embeddings.push_back(future.get());
+        } else {
+            embeddings = extractor.getEmbeddings(crops);
+        }
+    }
+    result.embedMs = msSince(start);
+    result.embeddings = embeddings.size();
+
+    start = Clock::now();
+    for (size_t k = 0; k < toEmbed.size(); ++k) {
+        FaceObservation& face = result.faces[toEmbed[k]];
+        if (Track* track = options.tracking ? tracker.find(face.trackId) : nullptr) {
+            tracker.addEmbedding(track->id, embeddings[k], qualities[k]);
+            match(track->embedding, track->identity, track->score);
+        } else {
+            match(embeddings[k], face.id, face.score);
+        }
+    }
+    result.matchMs = msSince(start);
+
+    if (options.tracking) {
+        for (FaceObservation& face : result.faces) {
+            if (const Track* track = tracker.find(face.trackId)) {
+                face.id = track->identity;
+                face.score = track->score;
+            }
+        }
+    }
+
+    lastFaces = result.faces;
+    result.latencyMs = msSince(frame.captured);
+    return result;
+}
+
+void VideoPipeline::match(const std::vector<float>& embedding, std::string& id, float& score) const {
+    std::vector<GalleryMatch> best = gallery.query(embedding, 1, -1.0f);
+    id.clear();
+    score = 0.0f;
+    if (best.empty())
+        return;
+    score = best.front().score;
+    if (score >= options.threshold)
+        id = std::move(best.front().id);
+}
@@ -0,0 +1,59 @@
+#include "video_source.hpp"
+#include <algorithm>
+#include <cctype>
+#include <iostream>
+#include <thread>
+
+bool VideoSource::open(const std::string& spec) {
+    close();
+    this->spec = spec;
+
+    bool isIndex = !spec.empty() && std::all_of(spec.begin(), spec.end(),
+                                                [](unsigned char c) { return std::isdigit(c); });
+    live = isIndex || spec.rfind("/dev/video", 0) == 0;
+
+    bool opened = isIndex ? capture.open(std::stoi(spec), cv::CAP_V4L2) ||
+                            capture.open(std::stoi(spec), cv::CAP_ANY)
+                          : capture.open(spec, live ? cv::CAP_V4L2 : cv::CAP_ANY);
+    if (!opened) {
+        std::cerr << "Cannot open video source: " << spec << "\n";
+        return false;
+    }
+
+    if (live) {
+        // Keep the driver queue short so frames are not already stale on arrival
+        capture.set(cv::CAP_PROP_BUFFERSIZE, 1);
+    }
+
+    frameRate = capture.get(cv::CAP_PROP_FPS);
+    if (!(frameRate > 0.0 && frameRate < 1000.0))
+        frameRate = 30.0;
+    nextIndex = 0;
+    started = std::chrono::steady_clock::now();
+    return true;
+}
+
+bool VideoSource::read(VideoFrame& frame) {
+    if (!capture.isOpened())
+        return false;
+
+    if (paced && !live) {
+        auto due = started + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                                 std::chrono::duration<double>(nextIndex / frameRate));
+        std::this_thread::sleep_until(due);
+    }
+
+    if (!capture.read(frame.image) || frame.image.empty())
+        return false;
+
+    frame.index = nextIndex++;
+    frame.captured = std::chrono::steady_clock::now();
+    frame.streamMs = live ? std::chrono::duration<double, std::milli>(frame.captured - started).count()
+                          : capture.get(cv::CAP_PROP_POS_MSEC);
+    return true;
+}
+
+void VideoSource::close() {
+    if (capture.isOpened())
+        capture.release();
+}
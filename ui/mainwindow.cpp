@@ -1,23 +1,39 @@
 #include <QStatusBar>
+#include <QMenuBar>
 #include "mainwindow.hpp"
 #include <QVBoxLayout>
 #include <QFileDialog>
 #include <QMessageBox>
 #include <QPixmap>
+#include <QImageReader>
 #include <QDir>
-#include <QListWidgetItem>
+#include <QFileInfo>
+#include <QPixmapCache>
 #include <QDesktopServices>
 #include <QUrl>
-#include <QPdfWriter>
-#include <opencv2/opencv.hpp>
-#include <QPainter>
+#include <QFutureWatcher>
+#include <QPointer>
+#include <QtConcurrent/QtConcurrentRun>
 #include "crawler.hpp"
-#include "crawler_worker.hpp"
+#include "scan_service.hpp"
 #include "result_data.hpp"
 #include "face_embedder.hpp"
+#include "qimage_view.hpp"
+#include "report_writer.hpp"
+#include "result_exporter.hpp"
+#include "match_server.hpp"
 
 extern std::vector<float> referenceEmbedding;
 
+namespace {
+
+bool savePathIsTable(const std::string& path) {
+    QString suffix = QFileInfo(QString::fromStdString(path)).suffix().toLower();
+    return suffix == "csv" || suffix == "jsonl";
+}
+
+}  // namespace
+
 MainWindow::MainWindow(QWidget *parent)
     : QMainWindow(parent)
 {
@@ -25,7 +41,14 @@ MainWindow::MainWindow(QWidget *parent)
     scanButton = new QPushButton("Scan", this);
     downloadButton = new QPushButton("Download Results", this);
     inputImageLabel = new QLabel(this);
-    resultList = new QListWidget(this);
+    resultModel = new ResultListModel(this);
+    resultView = new QListView(this);
+    resultView->setModel(resultModel);
+    // Uniform rows let the view lay out and paint only what is on screen
+    resultView->setUniformItemSizes(true);
+    resultView->setIconSize(QSize(ResultListModel::kDefaultThumbnailSize, ResultListModel::kDefaultThumbnailSize));
+    resultView->setLayoutMode(QListView::Batched);
+    QPixmapCache::setCacheLimit(32 * 1024);
 
     QWidget *central = new QWidget(this);
     QVBoxLayout *layout = new QVBoxLayout(central);
@@ -33,26 +56,72 @@ MainWindow::MainWindow(QWidget *parent)
     layout->addWidget(scanButton);
     layout->addWidget(downloadButton);
     layout->addWidget(inputImageLabel);
-    layout->addWidget(resultList);
+    layout->addWidget(resultView);
     setCentralWidget(central);
 
+    // Live stage timings, queue depths and resource use, toggled from View
+    metricsPanel = new MetricsPanel(this);
+    addDockWidget(Qt::RightDockWidgetArea, metricsPanel);
+    menuBar()->addMenu(tr("&View"))->addAction(metricsPanel->toggleViewAction());
+
     connect(uploadButton, &QPushButton::clicked, this, &MainWindow::onUploadImage);
     connect(scanButton, &QPushButton::clicked, this, &MainWindow::onStartScan);
     connect(downloadButton, &QPushButton::clicked, this, &MainWindow::onDownloadResults);
 
     downloadButton->setEnabled(false);
+    scanButton->setEnabled(false);
+    connect(this, &MainWindow::embeddingReady, this, &MainWindow::onEmbeddingReady);
+
+    // Load the model in the background so the first upload does not wait for it
+    if (qEnvironmentVariableIsEmpty("FACERECO_SOCKET")) {
+        statusBar()->showMessage("Loading face model...");
+        auto* preload = new QFutureWatcher<bool>(this);
+        connect(preload, &QFutureWatcher<bool>::finished, this, [this, preload]() {
+            if (!preload->result())
+                statusBar()->showMessage("Failed to load face model.");
+            else if (enrollGeneration == 0)
+                statusBar()->showMessage("Face model ready.");
+            preload->deleteLater();
+        });
+        preload->setFuture(QtConcurrent::run(&preloadFaceEmbedder));
+    }
+
+    // One scan thread for the life of the window; a new scan replaces the old one
+    scanService = new ScanService(this);
+    connect(scanService, &ScanService::matchFound, this, [this](int job, const MatchResult& match){
+        if (job != currentScan)
+            return;
+        // Matches stream in while the crawl runs and are inserted in rank order
+        resultModel->addMatch(match);
+        downloadButton->setEnabled(true);
+        statusBar()->showMessage(QString("Scanning the internet... %1 matches").arg(resultModel->rowCount()));
+    });
+    connect(scanService, &ScanService::jobFinished, this, [this](int job, const QVector<MatchResult>& rawResults, bool cancelled){
+        if (job != currentScan)
+            return;
+        // Everything normally arrived through matchFound already
+        if (resultModel->rowCount() == 0)
+            resultModel->addMatches(rawResults);
+
+        if (resultModel->rowCount() == 0) {
+            statusBar()->showMessage(cancelled ? "Scan cancelled." : "No matches found.");
+            downloadButton->setEnabled(false);
+        } else {
+            downloadButton->setEnabled(true);
+            statusBar()->showMessage(cancelled ? "Scan cancelled." : "Scan complete.");
+        }
 
-    connect(resultList, &QListWidget::itemDoubleClicked, this, [](QListWidgetItem* item){
-        QDesktopServices::openUrl(QUrl(item->toolTip()));
+        scanButton->setEnabled(true);
+    });
+
+    connect(resultView, &QListView::doubleClicked, this, [](const QModelIndex& index){
+        QDesktopServices::openUrl(QUrl(index.data(ResultListModel::UrlRole).toString()));
     });
 }
 
 MainWindow::~MainWindow() {
-    if (crawlerThread) {
-        crawlerThread->quit();
-        crawlerThread->wait();
-        delete crawlerThread;
-    }
+    // Stop the scan thread before the widgets it reports to go away
+    delete scanService;
     clearAllData();
 }
 
@@ -60,24 +129,70 @@ void MainWindow::onUploadImage()
 {
     QString filePath = QFileDialog::getOpenFileName(this, tr("Select Image"), QDir::homePath(), tr("Images (*.png *.jpg *.jpeg *.bmp *.webp *.tiff *.gif)"));
     if (!filePath.isEmpty()) {
+        // Decode once; the preview and the embedding share these pixels
+        QImageReader reader(filePath);
+        reader.setAutoTransform(true);
+        QImage image = reader.read();
+        if (image.isNull()) {
+            QMessageBox::critical(this, "Image Error", "Failed to load image.");
+            return;
+        }
+
         inputImagePath = filePath;
-        QPixmap pixmap(filePath);
-        inputImageLabel->setPixmap(pixmap.scaled(200, 200, Qt::KeepAspectRatio));
-        statusBar()->showMessage("Image loaded successfully.");
-        extractImageFeatures(filePath);
-        scanButton->setEnabled(true);
+        inputImageLabel->setPixmap(QPixmap::fromImage(image).scaled(200, 200, Qt::KeepAspectRatio));
+        extractImageFeatures(filePath, image);
     }
 }
 
-void MainWindow::extractImageFeatures(const QString& filePath)
+void MainWindow::extractImageFeatures(const QString& filePath, const QImage& image)
 {
-    cv::Mat img = cv::imread(filePath.toStdString());
-    if (img.empty()) {
-        QMessageBox::critical(this, "Image Error", "Failed to load image.");
+    // Inference runs on the thread pool; the result comes back through embeddingReady()
+    const int generation = ++enrollGeneration;
+    scanButton->setEnabled(false);
+    statusBar()->showMessage("Image loaded, computing face embedding...");
+
+    auto* watcher = new QFutureWatcher<std::vector<float>>(this);
+    connect(watcher, &QFutureWatcher<std::vector<float>>::finished, this, [this, watcher, generation]() {
+        // A newer upload supersedes this one
+        if (generation == enrollGeneration)
+            emit embeddingReady(watcher->result());
+        watcher->deleteLater();
+    });
+
+    QString socketPath = qEnvironmentVariable("FACERECO_SOCKET");
+    std::string absolutePath = QFileInfo(filePath).absoluteFilePath().toStdString();
+    watcher->setFuture(QtConcurrent::run([image, socketPath, absolutePath]() -> std::vector<float> {
+        // Use a running facereco-cli serve instance if one is configured
+        if (!socketPath.isEmpty()) {
+            MatchClient client;
+            nlohmann::json response;
+            if (client.connect(socketPath.toStdString()) &&
+                client.call({{"op", "embed"}, {"image", absolutePath}}, response) &&
+                response.contains("embedding")) {
+                return response["embedding"].get<std::vector<float>>();
+            }
+            qWarning("Matching service unavailable, computing locally.");
+        }
+
+        QImage converted;
+        ImageView view;
+        if (!imageViewFor(image, view)) {
+            converted = image.convertToFormat(QImage::Format_RGB32);
+            imageViewFor(converted, view);
+        }
+        return extractEmbeddingFromImage(view);
+    }));
+}
+
+void MainWindow::onEmbeddingReady(const std::vector<float>& embedding)
+{
+    referenceEmbedding = embedding;
+    if (embedding.empty()) {
+        statusBar()->showMessage("Could not compute face features for this image.");
         return;
     }
-
-    referenceEmbedding = extractEmbeddingFromImage(img);
+    statusBar()->showMessage("Image loaded successfully.");
+    scanButton->setEnabled(true);
 }
 
 
@@ -100,66 +215,19 @@ void MainWindow::onStartScan()
     }
 
     statusBar()->showMessage("Scanning the internet...");
-    resultList->clear();
+    resultModel->clear();
+    downloadButton->setEnabled(false);
     scanButton->setEnabled(false);
 
-    if (crawlerThread) {
-        crawlerThread->quit();
-        crawlerThread->wait();
-        delete crawlerThread;
-        crawlerThread = nullptr;
-    }
-
-    CrawlerWorker* worker = new CrawlerWorker(inputImagePath);
-    crawlerThread = new QThread;
-
-    worker->moveToThread(crawlerThread);
-
-    connect(crawlerThread, &QThread::started, worker, &CrawlerWorker::process);
-    connect(worker, &CrawlerWorker::resultsReady, this, [=](const QVector<std::pair<std::string, float>>& rawResults){
-        QVector<ResultData> results;
-        for (const auto& pair : rawResults) {
-            ResultData data;
-            data.url = QString::fromStdString(pair.first);
-            data.similarity = pair.second;
-            data.description = QString("Match with similarity: %1").arg(pair.second);
-            data.image = QPixmap(":/icons/match.png");
-            results.append(data);
-        }
-
-        this->results = results;
-        resultList->clear();
-
-        if (results.isEmpty()) {
-            statusBar()->showMessage("No matches found.");
-            downloadButton->setEnabled(false);
-        } else {
-            for (const auto &result : results) {
-                QListWidgetItem* item = new QListWidgetItem();
-                item->setIcon(QIcon(result.image));
-                item->setText(result.description + "\n" + result.url);
-                item->setToolTip(result.url);
-                resultList->addItem(item);
-            }
-            downloadButton->setEnabled(true);
-            statusBar()->showMessage("Scan complete.");
-        }
-
-        scanButton->setEnabled(true);
-    });
-
-    connect(worker, &CrawlerWorker::finished, crawlerThread, &QThread::quit);
-    connect(worker, &CrawlerWorker::finished, worker, &CrawlerWorker::deleteLater);
-    connect(crawlerThread, &QThread::finished, crawlerThread, &QThread::deleteLater);
-
-    crawlerThread->start();
+    currentScan = scanService->submit(inputImagePath, referenceEmbedding);
 }
 
 void MainWindow::onDownloadResults()
 {
-    QString folderPath = QFileDialog::getExistingDirectory(this, tr("Select Folder to Save PDF"), QDir::homePath());
-    if (!folderPath.isEmpty()) {
-        saveResultsToFolder(folderPath);
+    QString savePath = QFileDialog::getSaveFileName(this, tr("Save Report"), QDir::homePath() + "/results.pdf",
+                                                    tr("PDF (*.pdf);;HTML (*.html);;CSV (*.csv);;JSON Lines (*.jsonl)"));
+    if (!savePath.isEmpty()) {
+        saveResultsToFile(savePath);
     }
 }
 
@@ -179,30 +247,44 @@ QVector<ResultData> MainWindow::startImageScan(const QString &imagePath)
     return results;
 }
 
-bool MainWindow::saveResultsToFolder(const QString &folderPath)
+void MainWindow::saveResultsToFile(const QString &savePath)
 {
-    QString pdfPath = folderPath + "/results.pdf";
-    QPdfWriter pdf(pdfPath);
-    pdf.setPageSize(QPageSize(QPageSize::A4));
-    QPainter painter(&pdf);
-
-    int y = 0;
-    for (const auto& result : results) {
-        painter.drawPixmap(0, y, 100, 100, result.image);
-        painter.drawText(110, y + 20, result.description);
-        painter.drawText(110, y + 40, result.url);
-        y += 120;
-        if (y > pdf.height() - 120) {
-            pdf.newPage();
-            y = 0;
+    std::vector<MatchResult> snapshot = resultModel->matches();
+    downloadButton->setEnabled(false);
+    statusBar()->showMessage("Writing report...");
+
+    // The report is written on the thread pool; only progress comes back here
+    auto* watcher = new QFutureWatcher<bool>(this);
+    connect(watcher, &QFutureWatcher<bool>::finished, this, [this, watcher, savePath]() {
+        if (watcher->result())
+            statusBar()->showMessage("Report saved to: " + savePath);
+        else
+            statusBar()->showMessage("Failed to write report: " + savePath);
+        downloadButton->setEnabled(true);
+        watcher->deleteLater();
+    });
+
+    QPointer<MainWindow> self(this);
+    std::string path = savePath.toStdString();
+    watcher->setFuture(QtConcurrent::run([self, snapshot, path]() {
+        if (savePathIsTable(path)) {
+            ResultExporter exporter(path);
+            for (const auto& match : snapshot)
+                exporter.write(match);
+            return exporter.flush();
         }
-    }
-    painter.end();
-    statusBar()->showMessage("PDF saved to: " + pdfPath);
-    return true;
+        return writeReport(snapshot, path, [self](size_t done, size_t total) {
+            if (!self || (done != total && done % 16 != 0))
+                return;
+            QMetaObject::invokeMethod(self.data(), [self, done, total]() {
+                if (self)
+                    self->statusBar()->showMessage(QString("Writing report... %1/%2").arg(done).arg(total));
+            }, Qt::QueuedConnection);
+        });
+    }));
 }
 
 void MainWindow::clearAllData()
 {
-    resultList->clear();
+    resultModel->clear();
 }
@@ -1,14 +1,16 @@
 #pragma once
 #include "../include/crawler.hpp"
-#include "../include/crawler_worker.hpp"
+#include "../include/scan_service.hpp"
 #include "../include/result_data.hpp"
+#include "metrics_panel.hpp"
+#include "result_list_model.hpp"
 #include <QMainWindow>
 #include <QPushButton>
 #include <QLabel>
-#include <QListWidget>
+#include <QListView>
 #include <QString>
 #include <QVector>
-#include <QThread>
+#include <vector>
 
 class MainWindow : public QMainWindow {
     Q_OBJECT
@@ -17,28 +19,35 @@ public:
     MainWindow(QWidget *parent = nullptr);
     ~MainWindow();
 
+signals:
+    // Emitted on the GUI thread once the uploaded face has been embedded;
+    // empty if no embedding could be computed
+    void embeddingReady(const std::vector<float>& embedding);
+
 private slots:
     void onUploadImage();
+    void onEmbeddingReady(const std::vector<float>& embedding);
     void onStartScan();
     void onDownloadResults();
 
 private:
     Crawler* crawler = nullptr;
-    QThread* crawlerThread = nullptr;
+    ScanService* scanService;
+    int currentScan = 0;
     QPushButton *uploadButton;
     QPushButton *scanButton;
     QPushButton *downloadButton;
     QLabel *inputImageLabel;
-    QListWidget *resultList;
+    QListView *resultView;
+    ResultListModel *resultModel;
+    MetricsPanel *metricsPanel;
     QString inputImagePath;
+    int enrollGeneration = 0;
 
-    QVector<ResultData> results;
 
     QVector<ResultData> startImageScan(const QString &imagePath);
-    bool saveResultsToFolder(const QString &folderPath);
     void startWebCrawl(const QString &imagePath);
-    void addResult(const QPixmap &thumb, const QString &url, const QString &platform, const QString &user, double score);
     void saveResultsToFile(const QString &savePath);
     void clearAllData();
-    void extractImageFeatures(const QString& filePath);
+    void extractImageFeatures(const QString& filePath, const QImage& image);
 };
\ No newline at end of file
@@ -0,0 +1,146 @@
+#include "metrics_panel.hpp"
+#include <QFormLayout>
+#include <QHeaderView>
+#include <QLabel>
+#include <QTableWidget>
+#include <QTimer>
+#include <QVBoxLayout>
+#include <algorithm>
+#include <iterator>
+
+namespace {
+
+struct Stage {
+    const char* label;
+    const char* histogram;
+};
+
+const Stage kStages[] = {
+    {"Download", "download_ms"},
+    {"Decode", "decode_ms"},
+    {"Preprocess", "preprocess_ms"},
+    {"Inference", "inference_ms"},
+    {"Match", "match_ms"},
+    {"Report", "report_ms"},
+};
+
+const int kRefreshMs = 1000;
+
+// Samples recorded since the previous snapshot, for percentiles of recent work
+HistogramSnapshot window(const HistogramSnapshot& now, const HistogramSnapshot& before) {
+    HistogramSnapshot recent = now;
+    if (before.buckets.size() != now.buckets.size())
+        return recent;
+    recent.count = 0;
+    for (size_t i = 0; i < recent.buckets.size(); ++i) {
+        recent.buckets[i] -= before.buckets[i];
+        recent.count += recent.buckets[i];
+    }
+    recent.sumMs -= before.sumMs;
+    return recent;
+}
+
+template <typename Map>
+auto valueOr(const Map& map, const std::string& name, typename Map::mapped_type fallback = {}) {
+    auto it = map.find(name);
+    return it == map.end() ? fallback : it->second;
+}
+
+QString bytes(double count) {
+    const char* units[] = {"B", "KB", "MB", "GB"};
+    int unit = 0;
+    while (count >= 1024.0 && unit < 3) {
+        count /= 1024.0;
+        ++unit;
+    }
+    return QString("%1 %2").arg(count, 0, 'f', unit ? 1 : 0).arg(units[unit]);
+}
+
+}  // namespace
+
+MetricsPanel::MetricsPanel(QWidget* parent) : QDockWidget(tr("Performance"), parent) {
+    setObjectName("metricsPanel");
+
+    stageTable = new QTableWidget(static_cast<int>(std::size(kStages)), 4, this);
+    stageTable->setHorizontalHeaderLabels({tr("Images/s"), tr("p50 ms"), tr("p95 ms"), tr("p99 ms")});
+    stageTable->setEditTriggers(QAbstractItemView::NoEditTriggers);
+    stageTable->setSelectionMode(QAbstractItemView::NoSelection);
+    stageTable->horizontalHeader()->setSectionResizeMode(QHeaderView::Stretch);
+    for (int row = 0; row < stageTable->rowCount(); ++row) {
+        stageTable->setVerticalHeaderItem(row, new QTableWidgetItem(tr(kStages[row].label)));
+        for (int column = 0; column < stageTable->columnCount(); ++column) {
+            auto* item = new QTableWidgetItem("-");
+            item->setTextAlignment(Qt::AlignRight | Qt::AlignVCenter);
+            stageTable->setItem(row, column, item);
+        }
+    }
+
+    scanQueueLabel = new QLabel("-", this);
+    embeddingQueueLabel = new QLabel("-", this);
+    cacheLabel = new QLabel("-", this);
+    networkLabel = new QLabel("-", this);
+    memoryLabel = new QLabel("-", this);
+
+    auto* form = new QFormLayout;
+    form->addRow(tr("Scan queue:"), scanQueueLabel);
+    form->addRow(tr("Embedding queue:"), embeddingQueueLabel);
+    form->addRow(tr("Thumbnail cache:"), cacheLabel);
+    form->addRow(tr("Network:"), networkLabel);
+    form->addRow(tr("Memory:"), memoryLabel);
+
+    QWidget* contents = new QWidget(this);
+    auto* layout = new QVBoxLayout(contents);
+    layout->addWidget(stageTable);
+    layout->addLayout(form);
+    setWidget(contents);
+
+    timer = new QTimer(this);
+    timer->setInterval(kRefreshMs);
+    connect(timer, &QTimer::timeout, this, &MetricsPanel::refresh);
+}
+
+void MetricsPanel::showEvent(QShowEvent* event) {
+    QDockWidget::showEvent(event);
+    // Rates restart from here rather than averaging over the hidden time
+    previous = MetricsRegistry::instance().snapshot();
+    sinceLast.start();
+    timer->start();
+}
+
+void MetricsPanel::hideEvent(QHideEvent* event) {
+    timer->stop();
+    QDockWidget::hideEvent(event);
+}
+
+void MetricsPanel::refresh() {
+    MetricsSnapshot now = MetricsRegistry::instance().snapshot();
+    double seconds = std::max(sinceLast.restart(), qint64(1)) / 1000.0;
+
+    for (int row = 0; row < stageTable->rowCount(); ++row) {
+        HistogramSnapshot current = valueOr(now.histograms, kStages[row].histogram);
+        HistogramSnapshot recent = window(current, valueOr(previous.histograms, kStages[row].histogram));
+        stageTable->item(row, 0)->setText(QString::number(recent.count / seconds, 'f', 1));
+        const double quantiles[] = {0.50, 0.95, 0.99};
+        for (int i = 0; i < 3; ++i) {
+            stageTable->item(row, i + 1)->setText(recent.count ? QString::number(recent.quantile(quantiles[i]), 'f', 1)
+                                                               : QString("-"));
+        }
+    }
+
+    scanQueueLabel->setText(QString::number(valueOr(now.gauges, "scan_queue_depth")));
+    embeddingQueueLabel->setText(QString::number(valueOr(now.gauges, "embedding_queue_depth")));
+
+    uint64_t hits = valueOr(now.counters, "thumbnail_cache_hits");
+    uint64_t lookups = hits + valueOr(now.counters, "thumbnail_cache_misses");
+    cacheLabel->setText(lookups ? QString("%1% of %2 lookups").arg(100.0 * hits / lookups, 0, 'f', 1).arg(lookups)
+                                : QString("-"));
+
+    uint64_t received = valueOr(now.counters, "http_bytes_received");
+    uint64_t receivedBefore = valueOr(previous.counters, "http_bytes_received");
+    networkLabel->setText(QString("%1/s in, %2 total").arg(bytes((received - receivedBefore) / seconds)).arg(bytes(received)));
+
+    size_t resident = residentMemoryBytes();
+    memoryLabel->setText(resident ? bytes(resident) : QString("-"));
+
+    previous = std::move(now);
+}
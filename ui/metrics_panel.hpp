@@ -0,0 +1,37 @@
+#pragma once
+#include "../include/metrics.hpp"
+#include <QDockWidget>
+#include <QElapsedTimer>
+
+class QLabel;
+class QTableWidget;
+class QTimer;
+
+// Dockable view of the core metrics registry: throughput and latency
+// percentiles per pipeline stage, queue depths, thumbnail cache hit rate,
+// network throughput and memory. Samples the registry once a second while
+// visible; rates are the change since the previous sample.
+class MetricsPanel : public QDockWidget {
+    Q_OBJECT
+
+public:
+    explicit MetricsPanel(QWidget* parent = nullptr);
+
+protected:
+    void showEvent(QShowEvent* event) override;
+    void hideEvent(QHideEvent* event) override;
+
+private:
+    void refresh();
+
+    QTableWidget* stageTable;
+    QLabel* scanQueueLabel;
+    QLabel* embeddingQueueLabel;
+    QLabel* cacheLabel;
+    QLabel* networkLabel;
+    QLabel* memoryLabel;
+    QTimer* timer;
+
+    MetricsSnapshot previous;
+    QElapsedTimer sinceLast;
+};
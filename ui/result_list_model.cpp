@@ -0,0 +1,149 @@
+#include "result_list_model.hpp"
+#include "metrics.hpp"
+#include <QImage>
+#include <QPixmapCache>
+#include <QPointer>
+#include <QtConcurrent/QtConcurrentRun>
+#include <algorithm>
+
+namespace {
+
+QString cacheKey(quint64 id) {
+    return QStringLiteral("facereco/result/%1").arg(id);
+}
+
+// Rows run from highest to lowest similarity
+bool ranksBefore(float similarity, float other) {
+    return similarity > other;
+}
+
+}  // namespace
+
+ResultListModel::ResultListModel(QObject* parent)
+    : QAbstractListModel(parent), placeholder(":/icons/match.png") {}
+
+int ResultListModel::rowCount(const QModelIndex& parent) const {
+    return parent.isValid() ? 0 : static_cast<int>(rows.size());
+}
+
+QVariant ResultListModel::data(const QModelIndex& index, int role) const {
+    if (!index.isValid() || index.row() < 0 || index.row() >= static_cast<int>(rows.size()))
+        return {};
+    const Row& row = rows[index.row()];
+    const MatchResult& match = row.match;
+
+    switch (role) {
+    case Qt::DisplayRole:
+        return QString("Match with similarity: %1\n%2").arg(match.similarity).arg(QString::fromStdString(match.url));
+    case Qt::ToolTipRole:
+    case UrlRole:
+        return QString::fromStdString(match.url);
+    case SimilarityRole:
+        return match.similarity;
+    case SourceRole:
+        return QString::fromStdString(match.source);
+    case Qt::DecorationRole: {
+        if (match.thumbnail.empty())
+            return placeholder;
+        static Counter& hits = MetricsRegistry::instance().counter("thumbnail_cache_hits");
+        static Counter& misses = MetricsRegistry::instance().counter("thumbnail_cache_misses");
+        QPixmap pixmap;
+        if (QPixmapCache::find(cacheKey(row.id), &pixmap)) {
+            hits.add();
+            return pixmap;
+        }
+        misses.add();
+        requestThumbnail(row);
+        return placeholder;
+    }
+    default:
+        return {};
+    }
+}
+
+void ResultListModel::requestThumbnail(const Row& row) const {
+    if (pending.contains(row.id))
+        return;
+    pending.insert(row.id);
+
+    QPointer<ResultListModel> self(const_cast<ResultListModel*>(this));
+    quint64 id = row.id;
+    float similarity = row.match.similarity;
+    std::vector<unsigned char> bytes = row.match.thumbnail;
+    int size = thumbnailSize;
+    QtConcurrent::run([self, id, similarity, bytes, size]() {
+        QImage image;
+        if (image.loadFromData(bytes.data(), static_cast<int>(bytes.size())))
+            image = image.scaled(size, size, Qt::KeepAspectRatio, Qt::SmoothTransformation);
+        if (!self)
+            return;
+        QMetaObject::invokeMethod(self.data(), [self, id, similarity, image]() {
+            if (self)
+                self->thumbnailLoaded(id, similarity, image);
+        }, Qt::QueuedConnection);
+    });
+}
+
+void ResultListModel::thumbnailLoaded(quint64 id, float similarity, const QImage& image) {
+    pending.remove(id);
+    int row = rowFor(id, similarity);
+    if (row < 0)
+        return;
+
+    // Pixmaps can only be created on the GUI thread
+    QPixmapCache::insert(cacheKey(id), image.isNull() ? placeholder : QPixmap::fromImage(image));
+    QModelIndex changed = index(row);
+    emit dataChanged(changed, changed, {Qt::DecorationRole});
+}
+
+int ResultListModel::rowFor(quint64 id, float similarity) const {
+    auto first = std::lower_bound(rows.begin(), rows.end(), similarity,
+                                  [](const Row& row, float value) { return ranksBefore(row.match.similarity, value); });
+    for (auto it = first; it != rows.end() && it->match.similarity == similarity; ++it) {
+        if (it->id == id)
+            return static_cast<int>(it - rows.begin());
+    }
+    return -1;
+}
+
+void ResultListModel::addMatch(const MatchResult& match) {
+    auto position = std::upper_bound(rows.begin(), rows.end(), match.similarity,
+                                     [](float value, const Row& row) { return ranksBefore(value, row.match.similarity); });
+    int row = static_cast<int>(position - rows.begin());
+    beginInsertRows(QModelIndex(), row, row);
+    rows.insert(position, Row{match, nextId++});
+    endInsertRows();
+}
+
+void ResultListModel::addMatches(const QVector<MatchResult>& matches) {
+    // A few rows are cheaper to insert in place than to reset the view
+    if (matches.size() < 64) {
+        for (const MatchResult& match : matches)
+            addMatch(match);
+        return;
+    }
+
+    beginResetModel();
+    rows.reserve(rows.size() + matches.size());
+    for (const MatchResult& match : matches)
+        rows.push_back(Row{match, nextId++});
+    std::stable_sort(rows.begin(), rows.end(), [](const Row& a, const Row& b) {
+        return ranksBefore(a.match.similarity, b.match.similarity);
+    });
+    endResetModel();
+}
+
+void ResultListModel::clear() {
+    beginResetModel();
+    rows.clear();
+    pending.clear();
+    endResetModel();
+}
+
+std::vector<MatchResult> ResultListModel::matches() const {
+    std::vector<MatchResult> result;
+    result.reserve(rows.size());
+    for (const Row& row : rows)
+        result.push_back(row.match);
+    return result;
+}
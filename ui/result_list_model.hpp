@@ -0,0 +1,54 @@
+#pragma once
+#include "../include/match_result.hpp"
+#include <QAbstractListModel>
+#include <QPixmap>
+#include <QSet>
+#include <QVector>
+#include <vector>
+
+// Matches ordered by descending similarity, for a QListView. Rows are plain
+// MatchResults; pixmaps are only made for rows the view actually asks to
+// paint. Thumbnails are decoded and scaled on the thread pool and kept in
+// QPixmapCache, so memory stays bounded however many matches there are
+// and an evicted thumbnail is simply decoded again when scrolled back to.
+class ResultListModel : public QAbstractListModel {
+    Q_OBJECT
+
+public:
+    enum Roles {
+        UrlRole = Qt::UserRole + 1,
+        SimilarityRole,
+        SourceRole,
+    };
+
+    explicit ResultListModel(QObject* parent = nullptr);
+
+    int rowCount(const QModelIndex& parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex& index, int role = Qt::DisplayRole) const override;
+
+    // Inserts at the row that keeps the list sorted; equal scores keep arrival order
+    void addMatch(const MatchResult& match);
+    void addMatches(const QVector<MatchResult>& matches);
+    void clear();
+
+    std::vector<MatchResult> matches() const;
+
+    void setThumbnailSize(int pixels) { thumbnailSize = pixels; }
+    static constexpr int kDefaultThumbnailSize = 96;
+
+private:
+    struct Row {
+        MatchResult match;
+        quint64 id = 0;   // stable across inserts, keys the pixmap cache
+    };
+
+    void requestThumbnail(const Row& row) const;
+    void thumbnailLoaded(quint64 id, float similarity, const QImage& image);
+    int rowFor(quint64 id, float similarity) const;
+
+    std::vector<Row> rows;
+    quint64 nextId = 0;
+    mutable QSet<quint64> pending;
+    QPixmap placeholder;
+    int thumbnailSize = kDefaultThumbnailSize;
+};